@@ -0,0 +1,966 @@
+//////////////
+// Includes //
+//////////////
+#include "stdafx.h"
+#include "MeshGenerator.h"
+#include "SceneGraph.h"
+#include "Camera.h"
+#include "FlatSceneGraph.h"
+#include "MatrixKernel.h"
+#include "ThreadPool.h"
+#include "OrbitSystem.h"
+#include "SphereBVH.h"
+#include "RenderQueue.h"
+#include "NullRenderDevice.h"
+
+/* DEFINES */
+#define NUM_SAMPLES		25				// Timed runs per measurement, after one warm-up run
+#define JSON_FILE		"Benchmark.json"
+#define MATRIX_TOLERANCE	1e-5f		// Allowed difference from glm, relative to the largest element
+
+// Slice sizes (in degrees) to sweep, coarsest first.
+const float c_fSliceSweep[] = { 10.f, 5.f, 2.f, 1.f, 0.5f, 0.25f, 0.2f, 0.05f };
+const unsigned int c_iNumSlices = sizeof( c_fSliceSweep ) / sizeof( c_fSliceSweep[0] );
+
+// Detail to sweep per Topology, coarsest first (see eSphereTopology).
+const float c_fTopologySweep[MAX_TOPOLOGIES][4] = { { 10.f, 5.f, 2.f, 1.f }, { 2.f, 3.f, 4.f, 5.f }, { 5.f, 10.f, 20.f, 40.f } };
+const char* c_pTopologyNames[MAX_TOPOLOGIES] = { "uv", "ico", "cube" };
+
+// Transformation chain depths and Camera body counts to sweep.
+const unsigned int c_iChainSweep[] = { 1, 4, 16, 64, 256 };
+const unsigned int c_iBodySweep[] = { 1, 16, 256, 4096 };
+const unsigned int c_iFlatSweep[] = { 1024, 65536, 1048576 };
+const unsigned int c_iMatrixSweep[] = { 16, 1024, 65536 };
+const unsigned int c_iSceneSweep[] = { 256, 4096, 65536, 262144 };
+#define SCENE_SUBTREES	16		// Independent subtrees under the World root
+const unsigned int c_iOrbitSweep[] = { 1024, 65536, 1048576 };
+#define ORBIT_TOLERANCE	1e-4f		// Allowed difference from the double precision reference, relative to the Semi-Major Axis
+#define ORBIT_TIME		1234.5		// Simulation Time evaluated, several periods in for most orbits
+const unsigned int c_iBVHSweep[] = { 1024, 65536, 1048576 };
+#define BVH_QUERIES		64			// Rays and Radius queries per run
+const unsigned int c_iSubmitSweep[] = { 1024, 16384, 262144 };
+#define SUBMIT_PROGRAMS		3			// Distinct Programs, Textures and Instances per group in a submitted frame
+#define SUBMIT_TEXTURES		32
+#define SUBMIT_GROUP_SIZE	16
+
+// Allocation Tracking: every global operator new in the process is counted, from any thread.
+static atomic<size_t> g_iNumAllocs( 0 );
+static atomic<size_t> g_iAllocBytes( 0 );
+
+void* operator new( size_t iSize )
+{
+	void* pReturn = malloc( 0 == iSize ? 1 : iSize );
+
+	if ( NULL == pReturn )
+		throw bad_alloc();
+
+	++g_iNumAllocs;
+	g_iAllocBytes += iSize;
+	return pReturn;
+}
+
+void operator delete( void* pMemory ) noexcept
+{
+	free( pMemory );
+}
+
+// One measured configuration, all values per run.
+struct BenchResult
+{
+	string sName;
+	float fSize;
+	double dItems;				// Work items (vertices, matrices) per run
+	vector<double> vSamples;	// Seconds per run, sorted
+	double dAllocs, dAllocBytes;
+};
+
+// Keeps the optimizer from discarding benchmarked results.
+volatile float g_fSink = 0.f;
+vector<BenchResult> g_vResults;
+
+// Function Prototypes
+BenchResult measure( const string& sName, float fSize, unsigned int iInnerLoops, const function<double()>& pRun );
+double percentile( const vector<double>& vSorted, float fPercent );
+void printResult( const BenchResult& pResult );
+bool writeJSON( const string& sFileName );
+bool benchSphereGeneration();
+void benchSphereBuilds();
+void benchTransformChains();
+void benchCamera();
+void benchFlatScene();
+bool benchSceneUpdate();
+bool benchSceneChurn();
+bool benchOrbits();
+bool benchBVH();
+bool benchSubmission();
+bool benchMatrixKernels();
+unsigned long long meshChecksum( const MyMesh& pMesh );
+void reportIndexedSpheres();
+void reportTopologies();
+void reportSubmission();
+
+//
+// Entry for Benchmark
+// Headless: no window or GL context is created, only CPU-side work is timed.
+// Results are also written as JSON to the file given as the first argument (default JSON_FILE).
+int main( int argc, char** argv )
+{
+	string sJSONFile = argc > 1 ? argv[1] : JSON_FILE;
+	bool bAllMatch;
+
+	cout << "name\t\t\tsize\titems/sec\tp50 secs\tp99 secs\tallocs/run" << endl;
+	bAllMatch = benchSphereGeneration();
+	benchSphereBuilds();
+	benchTransformChains();
+	benchCamera();
+	benchFlatScene();
+	bAllMatch &= benchMatrixKernels();
+	bAllMatch &= benchSceneUpdate();
+	bAllMatch &= benchSceneChurn();
+	bAllMatch &= benchOrbits();
+	bAllMatch &= benchBVH();
+	bAllMatch &= benchSubmission();
+
+	reportIndexedSpheres();
+	reportTopologies();
+	reportSubmission();
+
+	if ( !writeJSON( sJSONFile ) )
+		cout << "Error: Unable to write " << sJSONFile << endl;
+
+	return bAllMatch ? 0 : 1;
+}
+
+/************************************************************************\
+ * Measurement                                                          *
+\************************************************************************/
+
+// Times pRun NUM_SAMPLES times after a warm-up run.  pRun repeats its work iInnerLoops times so
+// fast kernels are above timer resolution, and returns the work items done per loop.
+BenchResult measure( const string& sName, float fSize, unsigned int iInnerLoops, const function<double()>& pRun )
+{
+	BenchResult pResult;
+	size_t iStartAllocs, iStartBytes;
+
+	pResult.sName = sName;
+	pResult.fSize = fSize;
+	pResult.dItems = pRun();
+	pResult.vSamples.reserve( NUM_SAMPLES );
+
+	iStartAllocs = g_iNumAllocs;
+	iStartBytes = g_iAllocBytes;
+	for ( unsigned int i = 0; i < NUM_SAMPLES; ++i )
+	{
+		chrono::steady_clock::time_point mStart = chrono::steady_clock::now();
+		pRun();
+		chrono::duration<double> mElapsed = chrono::steady_clock::now() - mStart;
+		pResult.vSamples.push_back( mElapsed.count() / iInnerLoops );
+	}
+	pResult.dAllocs = (double)(g_iNumAllocs - iStartAllocs) / (NUM_SAMPLES * iInnerLoops);
+	pResult.dAllocBytes = (double)(g_iAllocBytes - iStartBytes) / (NUM_SAMPLES * iInnerLoops);
+
+	sort( pResult.vSamples.begin(), pResult.vSamples.end() );
+	printResult( pResult );
+	g_vResults.push_back( pResult );
+
+	return pResult;
+}
+
+// Nearest-rank percentile of sorted samples.
+double percentile( const vector<double>& vSorted, float fPercent )
+{
+	unsigned int iRank = (unsigned int)ceil( fPercent / 100.f * vSorted.size() );
+
+	return vSorted[iRank > 0 ? iRank - 1 : 0];
+}
+
+// One row of the human readable table.
+void printResult( const BenchResult& pResult )
+{
+	double dMedian = percentile( pResult.vSamples, 50.f );
+
+	cout << pResult.sName << (pResult.sName.size() < 16 ? "\t\t" : "\t")
+		 << pResult.fSize << "\t"
+		 << pResult.dItems / dMedian << "\t"
+		 << dMedian << "\t"
+		 << percentile( pResult.vSamples, 99.f ) << "\t"
+		 << pResult.dAllocs << endl;
+}
+
+// Writes every result as a JSON array of objects, one per measurement.
+bool writeJSON( const string& sFileName )
+{
+	ofstream pOut( sFileName.c_str() );
+
+	if ( !pOut.is_open() )
+		return false;
+
+	pOut << "[" << endl;
+	for ( unsigned int i = 0; i < g_vResults.size(); ++i )
+	{
+		const BenchResult& pResult = g_vResults[i];
+		double dMedian = percentile( pResult.vSamples, 50.f );
+
+		pOut << "  { \"name\": \"" << pResult.sName << "\""
+			 << ", \"size\": " << pResult.fSize
+			 << ", \"items\": " << pResult.dItems
+			 << ", \"items_per_sec\": " << pResult.dItems / dMedian
+			 << ", \"p50_secs\": " << dMedian
+			 << ", \"p99_secs\": " << percentile( pResult.vSamples, 99.f )
+			 << ", \"allocs\": " << pResult.dAllocs
+			 << ", \"alloc_bytes\": " << pResult.dAllocBytes
+			 << " }" << (i + 1 < g_vResults.size() ? "," : "") << endl;
+	}
+	pOut << "]" << endl;
+
+	return !pOut.fail();
+}
+
+/************************************************************************\
+ * Benchmarks                                                           *
+\************************************************************************/
+
+// Raw UV-Sphere generation, vectorized against scalar.  Returns false if the two ever differ.
+bool benchSphereGeneration()
+{
+	MyMesh pMesh;
+	unsigned long long iVectorSum;
+	int iVectorVerts;
+	bool bAllMatch = true;
+
+	// One Mesh is reused and compared by checksum, the finest slices take gigabytes each.
+	for ( unsigned int i = 0; i < c_iNumSlices; ++i )
+	{
+		float fSlice = c_fSliceSweep[i];
+
+		measure( "uv_generate_simd", fSlice, 1, [&]() { GenerateUVSphere( fSlice, &pMesh, true ); return (double)pMesh.iNumVerts; } );
+		iVectorSum = meshChecksum( pMesh );
+		iVectorVerts = pMesh.iNumVerts;
+		measure( "uv_generate_scalar", fSlice, 1, [&]() { GenerateUVSphere( fSlice, &pMesh, false ); return (double)pMesh.iNumVerts; } );
+
+		if ( iVectorVerts != pMesh.iNumVerts || iVectorSum != meshChecksum( pMesh ) )
+		{
+			cout << "Error: vectorized and scalar spheres differ at " << fSlice << " degrees." << endl;
+			bAllMatch = false;
+		}
+	}
+	vector<SphereVertex>().swap( pMesh.vVertices );
+
+	return bAllMatch;
+}
+
+// Everything a Planet's meshes go through before upload: generate, cache-optimize and pack.
+void benchSphereBuilds()
+{
+	MyMesh pMesh;
+
+	for ( unsigned int t = 0; t < MAX_TOPOLOGIES; ++t )
+		for ( unsigned int i = 0; i < 4; ++i )
+		{
+			float fDetail = c_fTopologySweep[t][i];
+
+			measure( string( "build_" ) + c_pTopologyNames[t], fDetail, 1, [&]()
+			{
+				GenerateSphere( (eSphereTopology)t, fDetail, &pMesh );
+				OptimizeVertexCache( pMesh.vIndices, pMesh.iNumVerts );
+				PackSphereVertices( &pMesh, true );
+				return (double)pMesh.iNumVerts;
+			} );
+		}
+}
+
+// World matrices for every node of a single parent chain, as RenderScene asks for them.  The root
+//	is rotated every loop so the whole chain is rebuilt; the cached variant leaves it clean.
+void benchTransformChains()
+{
+	const unsigned int iTargetMatrices = 100000;
+
+	for ( unsigned int d = 0; d < sizeof( c_iChainSweep ) / sizeof( c_iChainSweep[0] ); ++d )
+	{
+		unsigned int iDepth = c_iChainSweep[d];
+		unsigned int iLoops = iTargetMatrices / iDepth;
+		SceneGraph pGraph;
+		vector<Transformation*> vChain;
+		TransformHandle hParent = INVALID_TRANSFORM;
+
+		for ( unsigned int i = 0; i < iDepth; ++i )
+		{
+			hParent = pGraph.addTransformation( vec3( 1.f, 0.f, 0.f ), hParent );
+			vChain.push_back( pGraph.getTransformation( hParent ) );
+			vChain.back()->updateRotation( angleAxis( 0.1f, vec3( 0, 1, 0 ) ) );
+		}
+
+		measure( "transform_world", (float)iDepth, iLoops, [&]()
+		{
+			for ( unsigned int l = 0; l < iLoops; ++l )
+			{
+				vChain[0]->updateRotation( angleAxis( 0.001f, vec3( 0, 1, 0 ) ) );
+				for ( unsigned int i = 0; i < iDepth; ++i )
+					g_fSink = g_fSink + vChain[i]->getTransformationMatrix( true )[3][0];
+			}
+			return (double)iDepth;
+		} );
+
+		measure( "transform_world_cached", (float)iDepth, iLoops, [&]()
+		{
+			for ( unsigned int l = 0; l < iLoops; ++l )
+				for ( unsigned int i = 0; i < iDepth; ++i )
+					g_fSink = g_fSink + vChain[i]->getTransformationMatrix( true )[3][0];
+			return (double)iDepth;
+		} );
+	}
+}
+
+// Per-frame Camera work: view and projection matrices plus a projected radius per body.
+void benchCamera()
+{
+	const unsigned int iTargetBodies = 100000;
+	Camera pCamera( 1024, 1024 );
+
+	for ( unsigned int b = 0; b < sizeof( c_iBodySweep ) / sizeof( c_iBodySweep[0] ); ++b )
+	{
+		unsigned int iBodies = c_iBodySweep[b];
+		unsigned int iLoops = iTargetBodies / iBodies;
+
+		measure( "camera_frame", (float)iBodies, iLoops, [&]()
+		{
+			for ( unsigned int l = 0; l < iLoops; ++l )
+			{
+				pCamera.orbit( 0.1f, 0.f );
+				g_fSink = g_fSink + pCamera.getToCameraMat()[3][2] + pCamera.getPerspectiveMat()[0][0];
+				for ( unsigned int i = 0; i < iBodies; ++i )
+					g_fSink = g_fSink + pCamera.getProjectedRadius( vec3( (float)i, 0.f, 0.f ), 1.f );
+			}
+			return (double)(iBodies + 2);
+		} );
+	}
+}
+
+// Builds SCENE_SUBTREES 4-ary trees under the World root, iNumNodes in total.
+void buildScene( SceneGraph* pGraph, unsigned int iNumNodes, vector<Transformation*>& vNodes )
+{
+	vector<TransformHandle> vHandles;
+
+	pGraph->reserve( iNumNodes );
+	vHandles.reserve( iNumNodes );
+	vNodes.reserve( iNumNodes );
+	for ( unsigned int i = 0; i < iNumNodes; ++i )
+	{
+		TransformHandle hParent = i < SCENE_SUBTREES ? INVALID_TRANSFORM : vHandles[(i - SCENE_SUBTREES) / 4];
+
+		vHandles.push_back( pGraph->addTransformation( vec3( 1.f, 0.f, 0.f ), hParent ) );
+		vNodes.push_back( pGraph->getTransformation( vHandles.back() ) );
+	}
+}
+
+// Per-frame Scene Graph update: every node rotates, then the World Matrices are rebuilt serially
+//	and across the pool.  Returns false if the two disagree.
+bool benchSceneUpdate()
+{
+	ThreadPool* pPool = ThreadPool::getInstance();
+	quat qStep = angleAxis( 0.01f, vec3( 0, 1, 0 ) );
+	bool bAllMatch = true;
+
+	for ( unsigned int n = 0; n < sizeof( c_iSceneSweep ) / sizeof( c_iSceneSweep[0] ); ++n )
+	{
+		unsigned int iNumNodes = c_iSceneSweep[n];
+		SceneGraph pSerialGraph, pParallelGraph;
+		vector<Transformation*> vSerial, vParallel;
+		vector< vector<Transformation*> > vSubtrees( SCENE_SUBTREES );
+
+		buildScene( &pSerialGraph, iNumNodes, vSerial );
+		buildScene( &pParallelGraph, iNumNodes, vParallel );
+
+		// The first SCENE_SUBTREES nodes are the Subtree Roots.
+		for ( unsigned int i = 0; i < iNumNodes; ++i )
+		{
+			Transformation* pRoot = pParallelGraph.getSubtreeRoot( vParallel[i] );
+			vSubtrees[ find( vParallel.begin(), vParallel.begin() + SCENE_SUBTREES, pRoot ) - vParallel.begin() ].push_back( vParallel[i] );
+		}
+
+		measure( "scene_update_serial", (float)iNumNodes, 1, [&]()
+		{
+			for ( unsigned int i = 0; i < iNumNodes; ++i )
+				vSerial[i]->updateRotation( qStep );
+			pSerialGraph.updateWorldMatrices( NULL );
+			g_fSink = g_fSink + vSerial.back()->getTransformationMatrix( true )[3][0];
+			return (double)iNumNodes;
+		} );
+
+		measure( "scene_update_parallel", (float)iNumNodes, 1, [&]()
+		{
+			// Rotations stay within their own subtree's job, as GraphicsManager::updateScene() does.
+			for ( unsigned int r = 0; r < SCENE_SUBTREES; ++r )
+			{
+				pPool->addJob( [&, r]()
+				{
+					for ( unsigned int i = 0; i < vSubtrees[r].size(); ++i )
+						vSubtrees[r][i]->updateRotation( qStep );
+				} );
+			}
+			pPool->waitForAll();
+			pParallelGraph.updateWorldMatrices( pPool );
+			g_fSink = g_fSink + vParallel.back()->getTransformationMatrix( true )[3][0];
+			return (double)iNumNodes;
+		} );
+
+		// Both graphs took the same number of steps, results must be bit-identical.
+		for ( unsigned int i = 0; i < iNumNodes; ++i )
+		{
+			if ( vSerial[i]->getTransformationMatrix( true ) != vParallel[i]->getTransformationMatrix( true ) )
+			{
+				cout << "Error: Parallel Scene update differs from serial at " << iNumNodes << " nodes." << endl;
+				bAllMatch = false;
+				break;
+			}
+		}
+	}
+
+	delete pPool;
+	return bAllMatch;
+}
+
+// Bulk Kepler evaluation serially and across the pool.  Returns false if the two differ or either
+//	strays from OrbitSystem::ComputePosition().
+bool benchOrbits()
+{
+	ThreadPool* pPool = ThreadPool::getInstance();
+	bool bAllMatch = true;
+
+	for ( unsigned int n = 0; n < sizeof( c_iOrbitSweep ) / sizeof( c_iOrbitSweep[0] ); ++n )
+	{
+		unsigned int iNumOrbits = c_iOrbitSweep[n];
+		OrbitSystem pSerial, pParallel;
+		vector<OrbitalElements> vElements( iNumOrbits );
+		vector<double> vPeriods( iNumOrbits );
+
+		// Spread of shapes and orientations, up to the highest supported Eccentricity.
+		for ( unsigned int i = 0; i < iNumOrbits; ++i )
+		{
+			OrbitalElements& pElements = vElements[i];
+
+			pElements.fSemiMajorAxis = 1.f + (float)(i % 1000);
+			pElements.fEccentricity = MAX_ECCENTRICITY * (float)(i % 97) / 97.f;
+			pElements.fInclination = (float)(i % 89) / 89.f * 3.14159f;
+			pElements.fAscendingNode = (float)(i % 83) / 83.f * 6.28318f;
+			pElements.fArgPeriapsis = (float)(i % 79) / 79.f * 6.28318f;
+			pElements.fMeanAnomaly = (float)(i % 73) / 73.f * 6.28318f;
+			vPeriods[i] = 10.0 + (double)(i % 991);
+		}
+
+		pSerial.reserve( iNumOrbits );
+		pParallel.reserve( iNumOrbits );
+		for ( unsigned int i = 0; i < iNumOrbits; ++i )
+		{
+			pSerial.addOrbit( vElements[i], vPeriods[i] );
+			pParallel.addOrbit( vElements[i], vPeriods[i] );
+		}
+
+		measure( "orbit_evaluate_serial", (float)iNumOrbits, 1, [&]()
+		{
+			pSerial.evaluate( ORBIT_TIME, NULL );
+			g_fSink = g_fSink + pSerial.getPosition( iNumOrbits - 1 ).x;
+			return (double)iNumOrbits;
+		} );
+
+		measure( "orbit_evaluate_parallel", (float)iNumOrbits, 1, [&]()
+		{
+			pParallel.evaluate( ORBIT_TIME, pPool );
+			g_fSink = g_fSink + pParallel.getPosition( iNumOrbits - 1 ).x;
+			return (double)iNumOrbits;
+		} );
+
+		// Splitting the range can't change any result, and every orbit is close to the reference.
+		for ( unsigned int i = 0; i < iNumOrbits && bAllMatch; ++i )
+		{
+			vec3 vReference = OrbitSystem::ComputePosition( vElements[i], vPeriods[i], ORBIT_TIME );
+			vec3 vDelta = pSerial.getPosition( i ) - vReference;
+
+			if ( pSerial.getPosition( i ) != pParallel.getPosition( i ) )
+			{
+				cout << "Error: Parallel Orbit evaluation differs from serial at " << iNumOrbits << " orbits." << endl;
+				bAllMatch = false;
+			}
+			else if ( length( vDelta ) > ORBIT_TOLERANCE * vElements[i].fSemiMajorAxis )
+			{
+				cout << "Error: Orbit " << i << " is " << length( vDelta ) << " from the reference position." << endl;
+				bAllMatch = false;
+			}
+		}
+	}
+
+	return bAllMatch;
+}
+
+// Spheres scattered through a cube: building, refitting after every Sphere moved, and frustum,
+//	radius and ray queries against a brute force pass over every Sphere.  Returns false if any
+//	query disagrees with brute force.
+bool benchBVH()
+{
+	mat4 mViewProjection = perspective( radians( 60.f ), 16.f / 9.f, 0.01f, 10000.f ) * lookAt( vec3( 0.f, 0.f, 0.f ), vec3( 1.f, 0.3f, 0.6f ), vec3( 0.f, 1.f, 0.f ) );
+	bool bAllMatch = true;
+
+	srand( 877 );
+	for ( unsigned int n = 0; n < sizeof( c_iBVHSweep ) / sizeof( c_iBVHSweep[0] ); ++n )
+	{
+		unsigned int iNumSpheres = c_iBVHSweep[n];
+		float fExtent = 10.f * pow( (float)iNumSpheres, 1.f / 3.f );
+		SphereBVH pBVH;
+		vector<vec4> vSpheres( iNumSpheres );
+		vector<vec3> vOrigins( BVH_QUERIES ), vDirections( BVH_QUERIES );
+		vector<unsigned int> vFound, vExpected;
+		unsigned int iStep = 0;
+
+		for ( unsigned int i = 0; i < iNumSpheres; ++i )
+		{
+			vec3 vCenter = (vec3( (float)rand(), (float)rand(), (float)rand() ) / (float)RAND_MAX * 2.f - vec3( 1.f )) * fExtent;
+			vSpheres[i] = vec4( vCenter, 0.5f + (float)rand() / RAND_MAX * 1.5f );
+		}
+		for ( unsigned int q = 0; q < BVH_QUERIES; ++q )
+		{
+			vOrigins[q] = vec3( vSpheres[(q * 7919) % iNumSpheres] ) * 0.5f;
+			vDirections[q] = normalize( vec3( (float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f, (float)rand() / RAND_MAX - 0.5f ) + vec3( 0.01f ) );
+		}
+
+		pBVH.reserve( iNumSpheres );
+		for ( unsigned int i = 0; i < iNumSpheres; ++i )
+			pBVH.addSphere( vec3( vSpheres[i] ), vSpheres[i].w, i );
+
+		measure( "bvh_build", (float)iNumSpheres, 1, [&]()
+		{
+			pBVH.build();
+			return (double)iNumSpheres;
+		} );
+
+		// Every Sphere drifts a little each run, as bodies do between steps.
+		measure( "bvh_refit", (float)iNumSpheres, 1, [&]()
+		{
+			float fDrift = 0.01f * (float)(++iStep % 8);
+			for ( unsigned int i = 0; i < iNumSpheres; ++i )
+				pBVH.setSphere( i, vec3( vSpheres[i] ) + vec3( fDrift ), vSpheres[i].w );
+			pBVH.refit();
+			return (double)iNumSpheres;
+		} );
+
+		for ( unsigned int i = 0; i < iNumSpheres; ++i )
+			pBVH.setSphere( i, vec3( vSpheres[i] ), vSpheres[i].w );
+		pBVH.refit();
+
+		measure( "bvh_frustum", (float)iNumSpheres, 1, [&]()
+		{
+			vFound.clear();
+			pBVH.queryFrustum( mViewProjection, vFound );
+			return (double)iNumSpheres;
+		} );
+
+		measure( "bvh_radius", (float)iNumSpheres, 1, [&]()
+		{
+			vFound.clear();
+			for ( unsigned int q = 0; q < BVH_QUERIES; ++q )
+				pBVH.queryRadius( vOrigins[q], 20.f, vFound );
+			return (double)BVH_QUERIES;
+		} );
+
+		measure( "bvh_ray", (float)iNumSpheres, 1, [&]()
+		{
+			float fDistance;
+			for ( unsigned int q = 0; q < BVH_QUERIES; ++q )
+				g_fSink = g_fSink + (float)pBVH.queryRay( vOrigins[q], vDirections[q], &fDistance );
+			return (double)BVH_QUERIES;
+		} );
+
+		// Brute force references
+		mat4 mClip = mViewProjection;
+		vFound.clear();
+		vExpected.clear();
+		pBVH.queryFrustum( mViewProjection, vFound );
+		measure( "frustum_brute", (float)iNumSpheres, 1, [&]()
+		{
+			vExpected.clear();
+			for ( unsigned int i = 0; i < iNumSpheres; ++i )
+			{
+				vec4 vRow[4];
+				bool bVisible = true;
+
+				for ( int r = 0; r < 4; ++r )
+					vRow[r] = vec4( mClip[0][r], mClip[1][r], mClip[2][r], mClip[3][r] );
+				for ( int p = 0; p < 6 && bVisible; ++p )
+				{
+					vec4 vPlane = vRow[3] + vRow[p / 2] * (0 == p % 2 ? 1.f : -1.f);
+					bVisible = dot( vec3( vPlane ), vec3( vSpheres[i] ) ) + vPlane.w >= -vSpheres[i].w * length( vec3( vPlane ) );
+				}
+				if ( bVisible )
+					vExpected.push_back( i );
+			}
+			return (double)iNumSpheres;
+		} );
+		sort( vFound.begin(), vFound.end() );
+		bAllMatch &= vFound == vExpected;
+
+		for ( unsigned int q = 0; q < BVH_QUERIES && bAllMatch; ++q )
+		{
+			float fDistance, fBest = FLT_MAX;
+			unsigned int iHit = pBVH.queryRay( vOrigins[q], vDirections[q], &fDistance );
+			vec3 vDir = normalize( vDirections[q] );
+
+			vFound.clear();
+			vExpected.clear();
+			pBVH.queryRadius( vOrigins[q], 20.f, vFound );
+			for ( unsigned int i = 0; i < iNumSpheres; ++i )
+			{
+				vec3 vToCenter = vec3( vSpheres[i] ) - vOrigins[q];
+				float fAlong = dot( vToCenter, vDir );
+				vec3 vPerpendicular = vToCenter - vDir * fAlong;
+				float fDiscriminant = vSpheres[i].w * vSpheres[i].w - dot( vPerpendicular, vPerpendicular );
+
+				if ( length( vToCenter ) <= 20.f + vSpheres[i].w )
+					vExpected.push_back( i );
+				if ( fDiscriminant >= 0.f && fAlong - sqrt( fDiscriminant ) >= 0.f )
+					fBest = std::min( fBest, fAlong - sqrt( fDiscriminant ) );
+				else if ( dot( vToCenter, vToCenter ) <= vSpheres[i].w * vSpheres[i].w )
+					fBest = 0.f;
+			}
+			sort( vFound.begin(), vFound.end() );
+
+			bAllMatch &= vFound == vExpected;
+			bAllMatch &= INVALID_PROXY == iHit ? FLT_MAX == fBest : abs( fDistance - fBest ) <= 1e-3f * (1.f + fBest);
+		}
+
+		if ( !bAllMatch )
+		{
+			cout << "Error: BVH query differs from brute force at " << iNumSpheres << " spheres." << endl;
+			break;
+		}
+	}
+
+	return bAllMatch;
+}
+
+// Records a frame of iNumDraws Packets in scrambled order over SUBMIT_PROGRAMS Programs,
+//	SUBMIT_TEXTURES Textures and every Sphere LOD.  Odd Packets draw SUBMIT_GROUP_SIZE Instances,
+//	even ones draw once with their own Uniforms.
+void recordDrawPackets( RenderQueue* pQueue, unsigned int iNumDraws, unsigned int* pNumInstances )
+{
+	DrawUniforms pUniforms;
+	DrawPacket pPacket;
+
+	pUniforms.mToWorld = mat4( 1.f );
+	pUniforms.mLocalTransform = mat4( 1.f );
+	pUniforms.bLight = true;
+
+	pQueue->reset();
+	*pNumInstances = 0;
+	for ( unsigned int i = 0; i < iNumDraws; ++i )
+	{
+		unsigned int iHash = i * 2654435761u;
+
+		pPacket.iProgram = 1 + (iHash >> 8) % SUBMIT_PROGRAMS;
+		pPacket.iTexture = 1 + (iHash >> 12) % SUBMIT_TEXTURES;
+		pPacket.iMesh = (iHash >> 20) % NUM_SPHERE_LODS;
+		if ( i & 1 )
+		{
+			pPacket.iFirstInstance = *pNumInstances;
+			pPacket.iNumInstances = SUBMIT_GROUP_SIZE;
+			pPacket.iUniforms = INVALID_DRAW_UNIFORMS;
+			*pNumInstances += SUBMIT_GROUP_SIZE;
+		}
+		else
+		{
+			pPacket.iFirstInstance = 0;
+			pPacket.iNumInstances = 0;
+			pUniforms.mToWorld[3] = vec4( (float)i, 0.f, 0.f, 1.f );
+			pPacket.iUniforms = pQueue->pushUniforms( pUniforms );
+		}
+		pPacket.iKey = RenderQueue::makeKey( OPAQUE_LAYER, pPacket.iProgram, pPacket.iTexture, pPacket.iMesh, (float)(iHash % 10007) * 0.01f );
+		pQueue->push( pPacket );
+	}
+}
+
+// Records, sorts and submits frames to a Null Device that only counts, and to one that also
+//	records the Commands.  Returns false if the recorded frame has the wrong draws, uploads or
+//	binds, any redundant bind, or differs between two identical frames.
+bool benchSubmission()
+{
+	bool bAllMatch = true;
+
+	for ( unsigned int n = 0; n < sizeof( c_iSubmitSweep ) / sizeof( c_iSubmitSweep[0] ) && bAllMatch; ++n )
+	{
+		unsigned int iNumDraws = c_iSubmitSweep[n];
+		unsigned int iNumInstances, iNumSingle = (iNumDraws + 1) / 2;
+		RenderQueue pQueue;
+		NullRenderDevice pCounter( false ), pRecorder( true );
+		vector<BodyInstance> vInstances;
+		ostringstream pFirstFrame, pSecondFrame;
+
+		recordDrawPackets( &pQueue, iNumDraws, &iNumInstances );
+		vInstances.resize( iNumInstances );
+
+		measure( "queue_submit", (float)iNumDraws, 1, [&]()
+		{
+			recordDrawPackets( &pQueue, iNumDraws, &iNumInstances );
+			pCounter.beginFrame();
+			pCounter.uploadInstances( vInstances );
+			pQueue.submit( &pCounter );
+			pCounter.endFrame();
+			return (double)iNumDraws;
+		} );
+
+		measure( "queue_submit_recorded", (float)iNumDraws, 1, [&]()
+		{
+			recordDrawPackets( &pQueue, iNumDraws, &iNumInstances );
+			pRecorder.beginFrame();
+			pRecorder.uploadInstances( vInstances );
+			pQueue.submit( &pRecorder );
+			pRecorder.endFrame();
+			return (double)iNumDraws;
+		} );
+
+		const NullDeviceStats& pStats = pRecorder.getStats();
+		const RenderQueueStats& pQueueStats = pQueue.getStats();
+
+		// Each Program is bound once since they're sorted first, and the Queue never repeats a bind.
+		bAllMatch &= iNumDraws == pStats.iNumCommands[DRAW_CMD];
+		bAllMatch &= iNumSingle + iNumInstances == pStats.iNumInstancesDrawn;
+		bAllMatch &= iNumInstances * sizeof( BodyInstance ) + iNumSingle * (2 * sizeof( mat4 ) + sizeof( GLint )) == pStats.iBytesRequested;
+		bAllMatch &= SUBMIT_PROGRAMS == pStats.iNumCommands[BIND_PROGRAM_CMD];
+		bAllMatch &= 0 == pStats.iRedundantBinds;
+		bAllMatch &= pQueueStats.iProgramBinds + pQueueStats.iTextureBinds + pQueueStats.iMeshBinds == pStats.iStateChanges;
+		bAllMatch &= pStats.iNumCommands[DRAW_CMD] == pCounter.getStats().iNumCommands[DRAW_CMD];
+		bAllMatch &= pCounter.getCommands().empty();
+
+		// The same frame submits the same Command stream.
+		pRecorder.serialize( pFirstFrame );
+		recordDrawPackets( &pQueue, iNumDraws, &iNumInstances );
+		pRecorder.beginFrame();
+		pRecorder.uploadInstances( vInstances );
+		pQueue.submit( &pRecorder );
+		pRecorder.endFrame();
+		pRecorder.serialize( pSecondFrame );
+		bAllMatch &= pFirstFrame.str() == pSecondFrame.str();
+
+		if ( !bAllMatch )
+			cout << "Error: Submitted frame of " << iNumDraws << " draws doesn't match what was recorded." << endl;
+	}
+
+	return bAllMatch;
+}
+
+// State changes of frames submitted through the Render Queue against binding each Packet's
+//	state in recording order, as drawing immediately did.
+void reportSubmission()
+{
+	cout << endl << "Render Queue Submission (" << SUBMIT_PROGRAMS << " programs, " << SUBMIT_TEXTURES << " textures, " << NUM_SPHERE_LODS << " meshes)" << endl;
+	cout << "draws	immediate binds	sorted binds	binds avoided" << endl;
+
+	for ( unsigned int n = 0; n < sizeof( c_iSubmitSweep ) / sizeof( c_iSubmitSweep[0] ); ++n )
+	{
+		unsigned int iNumDraws = c_iSubmitSweep[n];
+		unsigned int iNumInstances;
+		RenderQueue pQueue;
+		NullRenderDevice pDevice( false );
+
+		recordDrawPackets( &pQueue, iNumDraws, &iNumInstances );
+		pDevice.beginFrame();
+		pQueue.submit( &pDevice );
+		pDevice.endFrame();
+
+		const RenderQueueStats& pStats = pQueue.getStats();
+
+		cout << iNumDraws << "\t"
+			 << 3 * iNumDraws << "\t\t"
+			 << pDevice.getStats().iStateChanges << "\t\t"
+			 << pStats.iProgramBindsAvoided + pStats.iTextureBindsAvoided + pStats.iMeshBindsAvoided << endl;
+	}
+}
+
+// Transient bodies: iNumBodies leaves are added under a small system and removed again every run.
+//	Once the pool is warm this shouldn't allocate.  Returns false if a removed Handle stays valid.
+bool benchSceneChurn()
+{
+	const unsigned int iNumBodies = 4096;
+	SceneGraph pGraph;
+	vector<TransformHandle> vBodies( iNumBodies );
+	TransformHandle hSun = pGraph.addTransformation( vec3( 0.f ), INVALID_TRANSFORM );
+	TransformHandle hPlanet = pGraph.addTransformation( vec3( 10.f, 0.f, 0.f ), hSun );
+	bool bAllMatch = true;
+
+	measure( "scene_churn", (float)iNumBodies, 1, [&]()
+	{
+		for ( unsigned int i = 0; i < iNumBodies; ++i )
+			vBodies[i] = pGraph.addTransformation( vec3( 1.f, 0.f, 0.f ), 0 == (i & 1) ? hSun : hPlanet );
+
+		// Remove out of insertion order so slots are reused in a scrambled order.
+		for ( unsigned int i = 0; i < iNumBodies; ++i )
+			pGraph.removeTransformation( vBodies[(i * 7919) % iNumBodies] );
+		return (double)iNumBodies;
+	} );
+
+	for ( unsigned int i = 0; i < iNumBodies; ++i )
+		bAllMatch &= !pGraph.isValid( vBodies[i] );
+
+	bAllMatch &= 2 == pGraph.getNumNodes() - 1 && pGraph.removeTransformation( hSun ) && !pGraph.isValid( hPlanet );
+	if ( !bAllMatch )
+		cout << "Error: Stale Scene Graph Handle still valid after removal." << endl;
+
+	return bAllMatch;
+}
+
+// Compares the indexed spheres against the flat triangle lists and reports the
+// post-transform cache behaviour before and after OptimizeVertexCache().
+void reportIndexedSpheres()
+{
+	MyMesh pMesh;
+	float fACMRBefore;
+
+	cout << endl << "Indexed Spheres (FIFO cache of " << VERTEX_CACHE_SIZE << ")" << endl;
+	cout << "slice	flat verts	indexed verts	triangles	ACMR before	ACMR after	optimize secs" << endl;
+
+	for ( unsigned int i = 0; i < c_iNumSlices; ++i )
+	{
+		GenerateIndexedUVSphere( c_fSliceSweep[i], &pMesh );
+		fACMRBefore = ComputeACMR( pMesh.vIndices, pMesh.iNumVerts, VERTEX_CACHE_SIZE );
+
+		chrono::steady_clock::time_point mStart = chrono::steady_clock::now();
+		OptimizeVertexCache( pMesh.vIndices, pMesh.iNumVerts );
+		chrono::duration<double> mElapsed = chrono::steady_clock::now() - mStart;
+
+		cout << c_fSliceSweep[i] << "\t"
+			 << pMesh.vIndices.size() << "\t\t"
+			 << pMesh.iNumVerts << "\t\t"
+			 << pMesh.vIndices.size() / 3 << "\t\t"
+			 << fACMRBefore << "\t\t"
+			 << ComputeACMR( pMesh.vIndices, pMesh.iNumVerts, VERTEX_CACHE_SIZE ) << "\t\t"
+			 << mElapsed.count() << endl;
+	}
+}
+
+// Compares the UV, Ico and Cube tessellations at similar triangle counts.
+void reportTopologies()
+{
+	const char* pNames[MAX_TOPOLOGIES] = { "UV", "Ico", "Cube" };
+	const float fDetail[MAX_TOPOLOGIES][3] = { { 10.f, 5.f, 2.f }, { 3.f, 4.f, 5.f }, { 10.f, 20.f, 40.f } };
+	MyMesh pMesh;
+
+	cout << endl << "Sphere Topologies" << endl;
+	cout << "topology	detail	vertices	triangles	ACMR optimized	generate secs" << endl;
+
+	for ( unsigned int t = 0; t < MAX_TOPOLOGIES; ++t )
+		for ( unsigned int i = 0; i < 3; ++i )
+		{
+			chrono::steady_clock::time_point mStart = chrono::steady_clock::now();
+			GenerateSphere( (eSphereTopology)t, fDetail[t][i], &pMesh );
+			chrono::duration<double> mElapsed = chrono::steady_clock::now() - mStart;
+			OptimizeVertexCache( pMesh.vIndices, pMesh.iNumVerts );
+
+			cout << pNames[t] << "\t\t"
+				 << fDetail[t][i] << "\t"
+				 << pMesh.iNumVerts << "\t\t"
+				 << pMesh.vIndices.size() / 3 << "\t\t"
+				 << ComputeACMR( pMesh.vIndices, pMesh.iNumVerts, VERTEX_CACHE_SIZE ) << "\t\t"
+				 << mElapsed.count() << endl;
+		}
+}
+
+// One forward sweep over a FlatSceneGraph shaped as a 4-ary tree (body -> moons -> ...).
+void benchFlatScene()
+{
+	for ( unsigned int n = 0; n < sizeof( c_iFlatSweep ) / sizeof( c_iFlatSweep[0] ); ++n )
+	{
+		unsigned int iNumNodes = c_iFlatSweep[n];
+		FlatSceneGraph pGraph;
+		vector<NodeHandle> vHandles;
+		TRS pLocal( vec3( 1.f, 0.f, 0.f ) );
+
+		pGraph.reserve( iNumNodes );
+		vHandles.reserve( iNumNodes );
+		pLocal.qRotation = angleAxis( 0.1f, vec3( 0.f, 1.f, 0.f ) );
+		for ( unsigned int i = 0; i < iNumNodes; ++i )
+			vHandles.push_back( pGraph.addNode( pLocal, 0 == i ? INVALID_NODE : vHandles[(i - 1) / 4] ) );
+
+		measure( "flat_scene_update", (float)iNumNodes, 1, [&]()
+		{
+			pGraph.updateWorldMatrices();
+			g_fSink = g_fSink + pGraph.getWorldMatrix( vHandles.back() )[3][0];
+			return (double)iNumNodes;
+		} );
+	}
+}
+
+// Batch mat4 products through each supported kernel against a plain glm loop.  Returns false if
+//	any kernel strays from glm by more than MATRIX_TOLERANCE.
+bool benchMatrixKernels()
+{
+	bool bAllMatch = true;
+
+	cout << "Matrix Kernel selected: " << GetMatrixKernelName( GetBestMatrixKernel() ) << endl;
+	srand( 453 );
+
+	for ( unsigned int n = 0; n < sizeof( c_iMatrixSweep ) / sizeof( c_iMatrixSweep[0] ); ++n )
+	{
+		unsigned int iCount = c_iMatrixSweep[n];
+		unsigned int iLoops = c_iMatrixSweep[sizeof( c_iMatrixSweep ) / sizeof( c_iMatrixSweep[0] ) - 1] / iCount;
+		vector<mat4> vLHS( iCount ), vRHS( iCount ), vExpected( iCount ), vOut( iCount );
+
+		for ( unsigned int i = 0; i < iCount; ++i )
+			for ( unsigned int c = 0; c < 4; ++c )
+				for ( unsigned int r = 0; r < 4; ++r )
+				{
+					vLHS[i][c][r] = (float)rand() / RAND_MAX * 2.f - 1.f;
+					vRHS[i][c][r] = (float)rand() / RAND_MAX * 2.f - 1.f;
+				}
+
+		measure( "mat4_multiply_glm", (float)iCount, iLoops, [&]()
+		{
+			for ( unsigned int l = 0; l < iLoops; ++l )
+				for ( unsigned int i = 0; i < iCount; ++i )
+					vExpected[i] = vLHS[i] * vRHS[i];
+			return (double)iCount;
+		} );
+
+		for ( int k = MATRIX_KERNEL_SCALAR; k < MAX_MATRIX_KERNELS; ++k )
+		{
+			eMatrixKernel eKernel = (eMatrixKernel)k;
+			float fMaxError = 0.f, fMaxValue = 0.f;
+
+			if ( !IsMatrixKernelSupported( eKernel ) )
+				continue;
+
+			measure( string( "mat4_multiply_" ) + GetMatrixKernelName( eKernel ), (float)iCount, iLoops, [&]()
+			{
+				for ( unsigned int l = 0; l < iLoops; ++l )
+					MultiplyMatrices( &vLHS[0], &vRHS[0], &vOut[0], iCount, eKernel );
+				return (double)iCount;
+			} );
+
+			for ( unsigned int i = 0; i < iCount; ++i )
+				for ( unsigned int c = 0; c < 4; ++c )
+					for ( unsigned int r = 0; r < 4; ++r )
+					{
+						float fError = fabs( vOut[i][c][r] - vExpected[i][c][r] );
+						fMaxError = fError > fMaxError ? fError : fMaxError;
+						fMaxValue = fabs( vExpected[i][c][r] ) > fMaxValue ? fabs( vExpected[i][c][r] ) : fMaxValue;
+					}
+
+			if ( fMaxError > MATRIX_TOLERANCE * fMaxValue )
+			{
+				cout << "Error: " << GetMatrixKernelName( eKernel ) << " kernel differs from glm by " << fMaxError << endl;
+				bAllMatch = false;
+			}
+		}
+	}
+
+	return bAllMatch;
+}
+
+// 64-bit FNV-1a over the vertex data, to compare Meshes too large to keep two of.
+unsigned long long meshChecksum( const MyMesh& pMesh )
+{
+	const unsigned char* pBytes = reinterpret_cast<const unsigned char*>( pMesh.vVertices.data() );
+	size_t iNumBytes = pMesh.vVertices.size() * sizeof( SphereVertex );
+	unsigned long long iHash = 14695981039346656037ULL;
+
+	for ( size_t i = 0; i < iNumBytes; ++i )
+		iHash = (iHash ^ pBytes[i]) * 1099511628211ULL;
+
+	return iHash;
+}
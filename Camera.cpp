@@ -73,6 +73,19 @@ vec3 Camera::getCameraWorldPos()
 	return getCartesianPos();
 }
 
+// Approximates the Radius, in pixels, of a Sphere at a World Position once projected to the screen.
+// Returns FLT_MAX if the Camera is inside the Sphere.
+float Camera::getProjectedRadius( const vec3& vWorldPos, float fRadius )
+{
+	float fDistance = length( vWorldPos - getCartesianPos() );
+	float fReturn = FLT_MAX;
+
+	if ( fDistance > fRadius )
+		fReturn = (fRadius / (fDistance * tan( FOV_Y * PI / 360.f ))) * ((float)m_iHeight * 0.5f);
+
+	return fReturn;
+}
+
 // Returns the Current Camera Position in Cartesian Coordinates
 vec3 Camera::getCartesianPos()
 {
@@ -20,6 +20,7 @@ public:
 	mat4 getToCameraMat();
 	mat4 getPerspectiveMat();
 	vec3 getCameraWorldPos();
+	float getProjectedRadius( const vec3& vWorldPos, float fRadius );
 
 	/// Camera Manipulation Functions
 	void orbit( float fDelta_X, float fDelta_Y );
@@ -0,0 +1,136 @@
+#include "FlatSceneGraph.h"
+
+// Constructor
+FlatSceneGraph::FlatSceneGraph()
+{
+
+}
+
+// Destructor
+FlatSceneGraph::~FlatSceneGraph()
+{
+	clear();
+}
+
+/************************************************************************\
+ * Graph Manipulation                                                   *
+\************************************************************************/
+
+// Appends a node under iParent (INVALID_NODE for a root).  Appending keeps the arrays in
+//	parent-before-child order since the parent is already stored.
+NodeHandle FlatSceneGraph::addNode( const TRS& pLocal, NodeHandle iParent )
+{
+	NodeHandle iHandle;
+
+	if ( INVALID_NODE != iParent && !isValid( iParent ) )
+	{
+		cout << "Error: Unable to add node to an invalid parent." << endl;
+		return INVALID_NODE;
+	}
+
+	// Reuse a freed Handle if there is one
+	if ( m_vFreeHandles.empty() )
+	{
+		iHandle = m_vSlots.size();
+		m_vSlots.push_back( INVALID_NODE );
+	}
+	else
+	{
+		iHandle = m_vFreeHandles.back();
+		m_vFreeHandles.pop_back();
+	}
+
+	m_vSlots[iHandle] = m_vLocals.size();
+	m_vLocals.push_back( pLocal );
+	m_vWorlds.push_back( pLocal.toMatrix() );
+	m_vParents.push_back( INVALID_NODE == iParent ? INVALID_NODE : m_vSlots[iParent] );
+	m_vHandles.push_back( iHandle );
+
+	return iHandle;
+}
+
+// Removes a node along with its whole subtree.  Descendants always follow their ancestors,
+//	so one forward pass finds them and a stable compaction keeps the order intact.
+void FlatSceneGraph::removeNode( NodeHandle iNode )
+{
+	unsigned int iFirst, iWrite;
+	vector<unsigned int> vRemap;
+
+	if ( !isValid( iNode ) )
+		return;
+
+	iFirst = m_vSlots[iNode];
+	iWrite = iFirst;
+	vRemap.resize( m_vLocals.size() - iFirst, INVALID_NODE );
+
+	for ( unsigned int iRead = iFirst; iRead < m_vLocals.size(); ++iRead )
+	{
+		unsigned int iParent = m_vParents[iRead];
+		bool bRemoved = iRead == iFirst ||
+						(INVALID_NODE != iParent && iParent >= iFirst && INVALID_NODE == vRemap[iParent - iFirst]);
+
+		if ( bRemoved )
+		{
+			m_vSlots[m_vHandles[iRead]] = INVALID_NODE;
+			m_vFreeHandles.push_back( m_vHandles[iRead] );
+			continue;
+		}
+
+		// Shift the survivor down, parents before iFirst never move
+		vRemap[iRead - iFirst] = iWrite;
+		m_vLocals[iWrite] = m_vLocals[iRead];
+		m_vWorlds[iWrite] = m_vWorlds[iRead];
+		m_vParents[iWrite] = (INVALID_NODE == iParent || iParent < iFirst) ? iParent : vRemap[iParent - iFirst];
+		m_vHandles[iWrite] = m_vHandles[iRead];
+		m_vSlots[m_vHandles[iWrite]] = iWrite;
+		++iWrite;
+	}
+
+	m_vLocals.resize( iWrite );
+	m_vWorlds.resize( iWrite );
+	m_vParents.resize( iWrite );
+	m_vHandles.resize( iWrite );
+}
+
+// Reserves storage for iNumNodes so building a large graph doesn't reallocate.
+void FlatSceneGraph::reserve( unsigned int iNumNodes )
+{
+	m_vLocals.reserve( iNumNodes );
+	m_vWorlds.reserve( iNumNodes );
+	m_vParents.reserve( iNumNodes );
+	m_vHandles.reserve( iNumNodes );
+	m_vLocalMatrices.reserve( iNumNodes );
+	m_vSlots.reserve( iNumNodes );
+}
+
+// Removes every node, invalidating all Handles.
+void FlatSceneGraph::clear()
+{
+	m_vLocals.clear();
+	m_vWorlds.clear();
+	m_vParents.clear();
+	m_vHandles.clear();
+	m_vLocalMatrices.clear();
+	m_vSlots.clear();
+	m_vFreeHandles.clear();
+}
+
+/************************************************************************\
+ * Update                                                               *
+\************************************************************************/
+
+// Single linear sweep: each parent's World Matrix is final before any child reads it.
+//	Local Matrices are built first so the products run through the SIMD batch kernel.
+void FlatSceneGraph::updateWorldMatrices()
+{
+	unsigned int iNumNodes = m_vLocals.size();
+
+	if ( 0 == iNumNodes )
+		return;
+
+	m_vLocalMatrices.resize( iNumNodes );
+	for ( unsigned int i = 0; i < iNumNodes; ++i )
+		m_vLocalMatrices[i] = m_vLocals[i].toMatrix();
+
+	PropagateWorldMatrices( &m_vParents[0], &m_vLocalMatrices[0], &m_vWorlds[0], iNumNodes );
+}
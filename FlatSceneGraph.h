@@ -0,0 +1,51 @@
+#pragma once
+#include "stdafx.h"
+#include "TRS.h"
+#include "MatrixKernel.h"
+
+// Definitions
+#define INVALID_NODE	0xFFFFFFFF
+
+// Handle to a node in a FlatSceneGraph, stays valid while nodes around it are added and removed.
+typedef unsigned int NodeHandle;
+
+// Class: FlatSceneGraph
+// Purpose: Data-oriented alternative to SceneGraph.  Nodes live in parallel arrays (local TRS,
+//			world matrix, parent index) kept in parent-before-child order, so every world matrix
+//			is computed in a single forward sweep with the parent's result already in hand.
+//			Handles map to array slots through an indirection table so nodes can move.
+class FlatSceneGraph
+{
+public:
+	FlatSceneGraph();
+	~FlatSceneGraph();
+
+	// Graph Manipulation
+	NodeHandle addNode( const TRS& pLocal, NodeHandle iParent );
+	void removeNode( NodeHandle iNode );
+	void reserve( unsigned int iNumNodes );
+	void clear();
+
+	// Node Access
+	bool isValid( NodeHandle iNode ) const { return iNode < m_vSlots.size() && INVALID_NODE != m_vSlots[iNode]; }
+	TRS& getLocal( NodeHandle iNode ) { return m_vLocals[m_vSlots[iNode]]; }
+	const mat4& getWorldMatrix( NodeHandle iNode ) const { return m_vWorlds[m_vSlots[iNode]]; }
+	unsigned int getNumNodes() const { return m_vLocals.size(); }
+
+	// Recomputes every World Matrix, parents before children.
+	void updateWorldMatrices();
+
+private:
+	FlatSceneGraph( const FlatSceneGraph& pCopy );	// Don't allow use of Copy Constructor
+
+	// Per Node, indexed by slot
+	vector<TRS> m_vLocals;
+	vector<mat4> m_vWorlds;
+	vector<unsigned int> m_vParents;	// Slot of the Parent, INVALID_NODE for roots.  Always < own slot.
+	vector<NodeHandle> m_vHandles;		// Handle owning each slot
+	vector<mat4> m_vLocalMatrices;		// Scratch for updateWorldMatrices()
+
+	// Handle Indirection
+	vector<unsigned int> m_vSlots;		// Slot of each Handle, INVALID_NODE when free
+	vector<NodeHandle> m_vFreeHandles;
+};
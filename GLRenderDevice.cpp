@@ -0,0 +1,69 @@
+#include "GLRenderDevice.h"
+#include "ShaderManager.h"
+
+// Default Constructor
+GLRenderDevice::GLRenderDevice()
+{
+	m_pShdrMngr = ShaderManager::getInstance();
+	m_pGmtryMngr = GeometryManager::getInstance();
+}
+
+// Destructor, the Managers are Singletons and aren't owned by the Device.
+GLRenderDevice::~GLRenderDevice()
+{
+	m_pShdrMngr = NULL;
+	m_pGmtryMngr = NULL;
+}
+
+// Nothing to set up, state left by other code is never assumed.
+void GLRenderDevice::beginFrame()
+{
+}
+
+// Unbind everything so code outside the Device starts from a clean state.
+void GLRenderDevice::endFrame()
+{
+	glBindVertexArray( 0 );
+	glUseProgram( 0 );
+}
+
+// Binds a Shader Program for the following draws.
+void GLRenderDevice::bindProgram( GLuint iProgram )
+{
+	glUseProgram( iProgram );
+}
+
+// Binds a 2D Texture to the active Texture unit.
+void GLRenderDevice::bindTexture( GLuint iTexture )
+{
+	glBindTexture( GL_TEXTURE_2D, iTexture );
+}
+
+// Binds a registered Mesh's Vertex Array.
+void GLRenderDevice::bindMesh( unsigned int iMesh )
+{
+	m_pGmtryMngr->bindMesh( iMesh );
+}
+
+// Per-draw Uniforms, repeated values are skipped by the ShaderManager's cache.
+void GLRenderDevice::setDrawUniforms( const DrawUniforms& pUniforms )
+{
+	m_pShdrMngr->setWorldMatrix( pUniforms.mToWorld );
+	m_pShdrMngr->setLocalTransform( pUniforms.mLocalTransform );
+	m_pShdrMngr->setLightBool( pUniforms.bLight );
+}
+
+// Streams the frame's Instances into the shared Instance Buffer.
+void GLRenderDevice::uploadInstances( const vector<BodyInstance>& vInstances )
+{
+	m_pGmtryMngr->uploadInstances( vInstances );
+}
+
+// Draws the bound Mesh, Instanced if iNumInstances isn't 0.
+void GLRenderDevice::drawMesh( unsigned int iMesh, unsigned int iFirstInstance, unsigned int iNumInstances )
+{
+	if ( 0 == iNumInstances )
+		m_pGmtryMngr->drawBoundMesh( iMesh );
+	else
+		m_pGmtryMngr->drawBoundMeshInstanced( iMesh, iFirstInstance, iNumInstances );
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+/* INCLUDES */
+#include "stdafx.h"
+#include "RenderDevice.h"
+
+// Forward Declarations
+class ShaderManager;
+
+// Class: GLRenderDevice
+// Purpose: Issues Render Device calls to OpenGL through the Shader and Geometry Managers.  Needs a
+//			current Context.
+class GLRenderDevice : public RenderDevice
+{
+public:
+	GLRenderDevice();
+	~GLRenderDevice();
+
+	void beginFrame();
+	void endFrame();
+
+	void bindProgram( GLuint iProgram );
+	void bindTexture( GLuint iTexture );
+	void bindMesh( unsigned int iMesh );
+	void setDrawUniforms( const DrawUniforms& pUniforms );
+
+	void uploadInstances( const vector<BodyInstance>& vInstances );
+	void drawMesh( unsigned int iMesh, unsigned int iFirstInstance, unsigned int iNumInstances );
+
+private:
+	ShaderManager* m_pShdrMngr;
+	GeometryManager* m_pGmtryMngr;
+};
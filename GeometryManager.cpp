@@ -4,11 +4,19 @@
 // input variables in the vertex shader
 const GLuint VERTEX_INDEX = 0;
 const GLuint COLOUR_INDEX = 1;
+const GLuint UV_INDEX = 1;
 const GLuint TEXTURE_INDEX = 2;
+const GLuint INSTANCE_INDEX = 3;		// mToWorld takes 3 to 6, Spin/Radius/Lit is 7
 
 // Assignment 3 - Patch Point Count
 #define NUM_CONTROL_POINTS 4
 
+// Detail of each level of the Sphere LOD chain per Topology, finest first.
+//	UV: Slice Size in degrees, Ico: Subdivisions, Cube: Divisions per face edge (even).
+const float c_fSphereLODDetail[MAX_TOPOLOGIES][NUM_SPHERE_LODS] = { { 2.f, 5.f, 10.f, 20.f, 30.f },
+																	{ 5.f, 4.f, 3.f, 2.f, 1.f },
+																	{ 40.f, 20.f, 10.f, 6.f, 4.f } };
+
 // Singleton static setup
 GeometryManager* GeometryManager::m_pInstance = NULL;
 
@@ -16,6 +24,8 @@ GeometryManager* GeometryManager::m_pInstance = NULL;
 GeometryManager::GeometryManager()
 {
 	m_bInitialized = false;
+	m_iInstanceBuffer = 0;
+	m_iInstanceCapacity = 0;
 }
 
 // Singleton getter.
@@ -37,6 +47,27 @@ GeometryManager::~GeometryManager()
 	glDeleteBuffers(1, &m_pGeometry.vertexBuffer);
 	glDeleteBuffers(1, &m_pGeometry.colourBuffer);
 	glDeleteBuffers(1, &m_pGeometry.textureBuffer);
+
+	// Clean up registered Meshes
+	for ( unsigned int i = 0; i < m_pMeshes.size(); ++i )
+	{
+		glDeleteVertexArrays( 1, &m_pMeshes[i].vertexArray );
+		glDeleteBuffers( 1, &m_pMeshes[i].vertexBuffer );
+		glDeleteBuffers( 1, &m_pMeshes[i].indexBuffer );
+	}
+	m_pMeshes.clear();
+	m_pSphereMeshes.clear();
+	glDeleteBuffers( 1, &m_iInstanceBuffer );
+
+	// Clean up any Meshes that were never uploaded
+	for ( map< pair< eSphereTopology, float >, PreparedSphere >::iterator iter = m_pPreparedMeshes.begin();
+		  iter != m_pPreparedMeshes.end();
+		  ++iter )
+	{
+		delete iter->second.pFile;
+		delete iter->second.pMesh;
+	}
+	m_pPreparedMeshes.clear();
 }
 
 // Initializes Geometry, currently from boilerplate code
@@ -97,3 +128,313 @@ void GeometryManager::bindTextureData(GLsizeiptr iPtr, void* data)
 	glBindBuffer(GL_ARRAY_BUFFER, m_pGeometry.textureBuffer);
 	glBufferData(GL_ARRAY_BUFFER, iPtr, data, GL_DYNAMIC_DRAW);
 }
+
+// Queues generation of every level of a Topology's LOD chain on the pool.  The meshes are
+// uploaded by getSphereMesh() on the main thread once they're needed.
+void GeometryManager::prepareSphereLODChain( eSphereTopology eTopology, ThreadPool* pPool )
+{
+	for ( unsigned int i = 0; i < NUM_SPHERE_LODS; ++i )
+	{
+		float fDetail = c_fSphereLODDetail[eTopology][i];
+		pPool->addJob( [this, eTopology, fDetail]() { prepareSphereMesh( eTopology, fDetail ); } );
+	}
+}
+
+// Fetches the handle of the Unit Sphere for a given Topology and Detail.  The Sphere is only generated
+// and uploaded the first time it's requested, every request after that shares the same mesh.
+// A Sphere a worker is still preparing is waited for rather than built a second time.
+// Must be called on the thread that owns the GL Context.
+unsigned int GeometryManager::getSphereMesh( eSphereTopology eTopology, float fDetail )
+{
+	pair< eSphereTopology, float > pKey( eTopology, fDetail );
+	map< pair< eSphereTopology, float >, unsigned int >::iterator iter;
+	map< pair< eSphereTopology, float >, PreparedSphere >::iterator pPrepared;
+	unsigned int iHandle;
+	PreparedSphere pSphere;
+	bool bClaimed = false;
+
+	{
+		unique_lock<mutex> pLock( m_pMeshMutex );
+		iter = m_pSphereMeshes.find( pKey );
+		if ( m_pSphereMeshes.end() != iter )
+			return iter->second;
+
+		pPrepared = m_pPreparedMeshes.find( pKey );
+		if ( m_pPreparedMeshes.end() == pPrepared )
+		{
+			// Nobody has started it, claim it so workers leave it alone
+			m_pPreparedMeshes[pKey] = pSphere;
+			bClaimed = true;
+		}
+		else
+		{
+			// Take the prepared mesh, waiting for it if a worker is still on it
+			m_pMeshPrepared.wait( pLock, [this, &pKey]()
+			{
+				const PreparedSphere& pEntry = m_pPreparedMeshes[pKey];
+				return NULL != pEntry.pFile || NULL != pEntry.pMesh;
+			} );
+			pSphere = m_pPreparedMeshes[pKey];
+			m_pPreparedMeshes.erase( pKey );
+		}
+	}
+
+	// Not prepared ahead of time, load or build it here
+	if ( bClaimed )
+		pSphere = loadSphereMesh( eTopology, fDetail );
+
+	// Mapped files go straight from the mapping to the GPU
+	iHandle = NULL != pSphere.pFile ? uploadMesh( pSphere.pFile ) : uploadMesh( pSphere.pMesh );
+	delete pSphere.pFile;
+	delete pSphere.pMesh;
+
+	unique_lock<mutex> pLock( m_pMeshMutex );
+	m_pSphereMeshes[pKey] = iHandle;
+	if ( bClaimed )
+		m_pPreparedMeshes.erase( pKey );
+
+	return iHandle;
+}
+
+// Fills pHandles with the mesh handles for every level of the Sphere LOD chain of a Topology.
+// pHandles must have room for NUM_SPHERE_LODS entries.
+void GeometryManager::getSphereLODChain( eSphereTopology eTopology, unsigned int* pHandles )
+{
+	for ( unsigned int i = 0; i < NUM_SPHERE_LODS; ++i )
+		pHandles[i] = getSphereMesh( eTopology, c_fSphereLODDetail[eTopology][i] );
+}
+
+// Loads or generates a Sphere into the prepared set unless it's already uploaded, prepared or
+// in progress.  Safe to call from any thread.
+void GeometryManager::prepareSphereMesh( eSphereTopology eTopology, float fDetail )
+{
+	pair< eSphereTopology, float > pKey( eTopology, fDetail );
+	PreparedSphere pSphere;
+
+	{
+		unique_lock<mutex> pLock( m_pMeshMutex );
+		if ( m_pSphereMeshes.count( pKey ) || m_pPreparedMeshes.count( pKey ) )
+			return;
+		m_pPreparedMeshes[pKey] = pSphere;
+	}
+
+	pSphere = loadSphereMesh( eTopology, fDetail );
+
+	{
+		unique_lock<mutex> pLock( m_pMeshMutex );
+		m_pPreparedMeshes[pKey] = pSphere;
+	}
+	m_pMeshPrepared.notify_all();
+}
+
+// Maps the Sphere from the Mesh Cache if a matching file exists, otherwise generates it and
+// writes it back to the cache for the next run.  Safe to call from any thread.
+PreparedSphere GeometryManager::loadSphereMesh( eSphereTopology eTopology, float fDetail )
+{
+	string sFileName = MeshFile::getSphereFileName( eTopology, fDetail );
+	PreparedSphere pReturn;
+
+	if ( USE_MESH_CACHE )
+	{
+		pReturn.pFile = new MeshFile();
+		if ( pReturn.pFile->open( sFileName ) && pReturn.pFile->matches( eTopology, fDetail, PACK_SPHERE_VERTICES ) )
+			return pReturn;
+
+		delete pReturn.pFile;
+		pReturn.pFile = NULL;
+	}
+
+	pReturn.pMesh = buildSphereMesh( eTopology, fDetail );
+
+	if ( USE_MESH_CACHE && !MeshFile::write( sFileName, eTopology, fDetail, pReturn.pMesh ) )
+	{
+		unique_lock<mutex> pLock( m_pMeshMutex );
+		cout << "Warning: Unable to write Mesh Cache " << sFileName << endl;
+	}
+
+	return pReturn;
+}
+
+// Generates, cache-optimizes and packs a Sphere.  No GL calls are made so this may run on
+// any thread; the caller owns the returned Mesh.
+MyMesh* GeometryManager::buildSphereMesh( eSphereTopology eTopology, float fDetail )
+{
+	MyMesh* pMesh = new MyMesh();
+
+	GenerateSphere( eTopology, fDetail, pMesh );
+
+	// Reorder for the post-transform cache
+	OptimizeVertexCache( pMesh->vIndices, pMesh->iNumVerts );
+
+	if ( PACK_SPHERE_VERTICES )
+		PackSphereVertices( pMesh, true );
+
+	return pMesh;
+}
+
+// Uploads a generated mesh, narrowing its indices to 16-bit when every vertex fits.  The CPU
+// copy is no longer required once this returns.
+unsigned int GeometryManager::uploadMesh( const MyMesh* pMesh )
+{
+	bool bPacked = !pMesh->vPackedVertices.empty();
+	const GLvoid* pData = bPacked ? (const GLvoid*)&pMesh->vPackedVertices[0] : (const GLvoid*)&pMesh->vVertices[0];
+	unsigned int iReturn;
+
+	if ( !pMesh->vIndices.empty() && pMesh->iNumVerts <= USHRT_MAX + 1 )
+	{
+		vector<GLushort> vShortIndices( pMesh->vIndices.begin(), pMesh->vIndices.end() );
+		iReturn = uploadMesh( pData, bPacked, pMesh->iNumVerts, &vShortIndices[0], GL_UNSIGNED_SHORT, vShortIndices.size() );
+	}
+	else
+		iReturn = uploadMesh( pData, bPacked, pMesh->iNumVerts,
+							  pMesh->vIndices.empty() ? NULL : &pMesh->vIndices[0], GL_UNSIGNED_INT, pMesh->vIndices.size() );
+
+	return iReturn;
+}
+
+// Uploads a mesh straight out of a mapped .mesh file, the blobs are already in upload layout.
+unsigned int GeometryManager::uploadMesh( const MeshFile* pFile )
+{
+	const MeshFileHeader* pHeader = pFile->getHeader();
+
+	return uploadMesh( pFile->getVertices(), MESH_FORMAT_PACKED == pHeader->iVertexFormat, pHeader->iNumVerts,
+					   pFile->getIndices(), pHeader->iIndexType, pHeader->iNumIndices );
+}
+
+// Uploads vertices and indices into their own static, interleaved buffer and Vertex Array.
+// iNumIndices of 0 uploads a non-indexed Triangle List.
+unsigned int GeometryManager::uploadMesh( const GLvoid* pVertices, bool bPacked, GLuint iNumVerts,
+										  const GLvoid* pIndices, GLenum eIndexType, GLuint iNumIndices )
+{
+	MyGeometry pGeometry;
+	GLsizei iStride = bPacked ? sizeof( PackedSphereVertex ) : sizeof( SphereVertex );
+
+	pGeometry.vertexCount = iNumVerts;
+
+	// create an array buffer object for storing our vertices
+	glGenBuffers( 1, &pGeometry.vertexBuffer );
+	glBindBuffer( GL_ARRAY_BUFFER, pGeometry.vertexBuffer );
+	glBufferData( GL_ARRAY_BUFFER, iStride * iNumVerts, pVertices, GL_STATIC_DRAW );
+
+	// create a vertex array object encapsulating all our vertex attributes
+	glGenVertexArrays( 1, &pGeometry.vertexArray );
+	glBindVertexArray( pGeometry.vertexArray );
+
+	// Position and Texture Coordinates are interleaved in the one buffer
+	if ( bPacked )
+	{
+		glVertexAttribPointer( VERTEX_INDEX, 3, GL_SHORT, GL_TRUE, iStride, (const GLvoid*)offsetof( PackedSphereVertex, iPosition ) );
+		glVertexAttribPointer( UV_INDEX, 2, GL_UNSIGNED_SHORT, GL_TRUE, iStride, (const GLvoid*)offsetof( PackedSphereVertex, iUV ) );
+	}
+	else
+	{
+		glVertexAttribPointer( VERTEX_INDEX, 3, GL_FLOAT, GL_FALSE, iStride, (const GLvoid*)offsetof( SphereVertex, fPosition ) );
+		glVertexAttribPointer( UV_INDEX, 2, GL_FLOAT, GL_FALSE, iStride, (const GLvoid*)offsetof( SphereVertex, fUV ) );
+	}
+	glEnableVertexAttribArray( VERTEX_INDEX );
+	glEnableVertexAttribArray( UV_INDEX );
+
+	// Instance Attributes advance once per Instance, the buffer is shared between all Meshes.
+	if ( 0 == m_iInstanceBuffer )
+		glGenBuffers( 1, &m_iInstanceBuffer );
+	glBindBuffer( GL_ARRAY_BUFFER, m_iInstanceBuffer );
+	for ( GLuint i = INSTANCE_INDEX; i < INSTANCE_INDEX + 5; ++i )
+	{
+		glEnableVertexAttribArray( i );
+		glVertexAttribDivisor( i, 1 );
+	}
+	setInstanceAttributes( 0 );
+
+	// Index Buffer is captured by the Vertex Array.
+	if ( 0 != iNumIndices )
+	{
+		pGeometry.indexCount = iNumIndices;
+		pGeometry.indexType = eIndexType;
+		glGenBuffers( 1, &pGeometry.indexBuffer );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, pGeometry.indexBuffer );
+		glBufferData( GL_ELEMENT_ARRAY_BUFFER,
+					  (GL_UNSIGNED_SHORT == eIndexType ? sizeof( GLushort ) : sizeof( GLuint )) * iNumIndices,
+					  pIndices, GL_STATIC_DRAW );
+	}
+
+	// unbind our buffers, resetting to default state
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glBindVertexArray( 0 );
+
+	if ( CheckGLErrors() )
+		cout << "Error: Couldn't upload mesh." << endl;
+
+	m_pMeshes.push_back( pGeometry );
+	return m_pMeshes.size() - 1;
+}
+
+// Points the bound Vertex Array's Instance Attributes at iOffset bytes into the Instance Buffer,
+//	which must be bound to GL_ARRAY_BUFFER.
+void GeometryManager::setInstanceAttributes( GLintptr iOffset )
+{
+	GLsizei iStride = sizeof( BodyInstance );
+
+	for ( GLuint i = 0; i < 4; ++i )
+		glVertexAttribPointer( INSTANCE_INDEX + i, 4, GL_FLOAT, GL_FALSE, iStride, (const GLvoid*)(iOffset + offsetof( BodyInstance, fToWorld ) + i * 4 * sizeof( GLfloat )) );
+	glVertexAttribPointer( INSTANCE_INDEX + 4, 4, GL_FLOAT, GL_FALSE, iStride, (const GLvoid*)(iOffset + offsetof( BodyInstance, fSpin )) );
+}
+
+// Replaces the contents of the Instance Buffer, growing it as needed.  Otherwise the old storage
+//	is orphaned so the driver doesn't wait on draws still reading last frame's Instances.
+void GeometryManager::uploadInstances( const vector<BodyInstance>& vInstances )
+{
+	GLsizeiptr iSize = vInstances.size() * sizeof( BodyInstance );
+
+	if ( 0 == m_iInstanceBuffer )
+		glGenBuffers( 1, &m_iInstanceBuffer );
+
+	glBindBuffer( GL_ARRAY_BUFFER, m_iInstanceBuffer );
+	if ( iSize > m_iInstanceCapacity )
+		m_iInstanceCapacity = iSize + iSize / 2;
+	glBufferData( GL_ARRAY_BUFFER, m_iInstanceCapacity, NULL, GL_STREAM_DRAW );
+	if ( 0 != iSize )
+		glBufferSubData( GL_ARRAY_BUFFER, 0, iSize, vInstances.data() );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+// Draws iNumInstances of a registered Mesh starting at iFirstInstance in the Instance Buffer.
+//	GL 4.1 has no base instance, so the Instance Attributes are offset instead.
+void GeometryManager::drawMeshInstanced( unsigned int iHandle, unsigned int iFirstInstance, unsigned int iNumInstances )
+{
+	bindMesh( iHandle );
+	drawBoundMeshInstanced( iHandle, iFirstInstance, iNumInstances );
+}
+
+// Draws Instances of the bound Mesh.  The Instance attributes belong to the Vertex Array, so
+//	they're pointed at iFirstInstance on every draw.
+void GeometryManager::drawBoundMeshInstanced( unsigned int iHandle, unsigned int iFirstInstance, unsigned int iNumInstances )
+{
+	const MyGeometry& pGeometry = m_pMeshes[iHandle];
+
+	glBindBuffer( GL_ARRAY_BUFFER, m_iInstanceBuffer );
+	setInstanceAttributes( iFirstInstance * sizeof( BodyInstance ) );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	if ( 0 != pGeometry.indexCount )
+		glDrawElementsInstanced( GL_TRIANGLES, pGeometry.indexCount, pGeometry.indexType, 0, iNumInstances );
+	else
+		glDrawArraysInstanced( GL_TRIANGLES, 0, pGeometry.vertexCount, iNumInstances );
+}
+
+// Binds a registered Mesh and draws it as a Triangle List.
+void GeometryManager::drawMesh( unsigned int iHandle )
+{
+	bindMesh( iHandle );
+	drawBoundMesh( iHandle );
+}
+
+// Draws the bound Mesh as a Triangle List.
+void GeometryManager::drawBoundMesh( unsigned int iHandle )
+{
+	const MyGeometry& pGeometry = m_pMeshes[iHandle];
+
+	if ( 0 != pGeometry.indexCount )
+		glDrawElements( GL_TRIANGLES, pGeometry.indexCount, pGeometry.indexType, 0 );
+	else
+		glDrawArrays( GL_TRIANGLES, 0, pGeometry.vertexCount );
+}
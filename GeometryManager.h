@@ -1,6 +1,9 @@
 #pragma once
 
 #include "stdafx.h"
+#include "MeshGenerator.h"
+#include "ThreadPool.h"
+#include "MeshFile.h"
 
 // Geometry Structure
 struct MyGeometry
@@ -9,17 +12,48 @@ struct MyGeometry
 	GLuint  vertexBuffer;
 	GLuint  colourBuffer;
 	GLuint	textureBuffer;
+	GLuint  indexBuffer;
 	GLuint  vertexArray;
+	GLsizei vertexCount;
+	GLsizei indexCount;		// 0 for a non-indexed mesh
+	GLenum  indexType;		// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
 
 
 	// initialize object names to zero (OpenGL reserved value)
-	MyGeometry() : vertexBuffer( 0 ), colourBuffer( 0 ), vertexArray( 0 )
+	MyGeometry() : vertexBuffer( 0 ), colourBuffer( 0 ), textureBuffer( 0 ), indexBuffer( 0 ), vertexArray( 0 ),
+				   vertexCount( 0 ), indexCount( 0 ), indexType( GL_UNSIGNED_INT )
 	{
 	}
 };
 
+// Per-Instance data for drawing a Body with the instanced shaders (80 bytes).  The Local Spin
+//	about +Y and the Radius are applied in the shader, before mToWorld.
+struct BodyInstance
+{
+	GLfloat fToWorld[16];
+	GLfloat fSpin;			// Radians
+	GLfloat fRadius;
+	GLfloat fLit;			// 1 to light the Body, 0 for self-lit Bodies
+	GLfloat fPadding;
+};
+
 // Definitions
 #define MAX_BUFFER_SIZE		100000
+#define NUM_SPHERE_LODS		5		// Number of Sphere Meshes in the LOD chain, 0 is the finest.
+#define PACK_SPHERE_VERTICES	true	// Upload Spheres as 16-bit PackedSphereVertex instead of float SphereVertex.
+#define USE_MESH_CACHE			true	// Load Spheres from .mesh files when present, write them out when generated.
+
+// A Sphere waiting to be uploaded: mapped from the Mesh Cache or freshly generated.
+//	Both are NULL while it's still being prepared.
+struct PreparedSphere
+{
+	MeshFile* pFile;
+	MyMesh* pMesh;
+
+	PreparedSphere() : pFile( NULL ), pMesh( NULL )
+	{
+	}
+};
 
 // Class: GeometryManager
 // Purpose: Manages a geometry structure for each Assignment.  Ensures proper setup of
@@ -38,6 +72,23 @@ public:
 
 	// To get a Geometry Pointer, unable to be modified
 	MyGeometry const* getGeometry() { return &m_pGeometry; }
+
+	// Mesh Preparation: generates CPU-side meshes on the pool, ahead of getSphereMesh().
+	void prepareSphereLODChain( eSphereTopology eTopology, ThreadPool* pPool );
+
+	// Mesh Registry: Meshes are uploaded to the GPU once and referenced by handle afterwards.
+	unsigned int getSphereMesh( eSphereTopology eTopology, float fDetail );
+	void getSphereLODChain( eSphereTopology eTopology, unsigned int* pHandles );
+	MyGeometry const* getMesh( unsigned int iHandle ) { return &m_pMeshes[iHandle]; }
+	void bindMesh( unsigned int iHandle ) { glBindVertexArray( m_pMeshes[iHandle].vertexArray ); }
+	void drawMesh( unsigned int iHandle );
+	void drawBoundMesh( unsigned int iHandle );		// iHandle must already be bound by bindMesh()
+
+	// Instancing: every Mesh reads its Instances from one shared buffer.  Upload every Instance for
+	//	the frame once, then draw ranges of it.
+	void uploadInstances( const vector<BodyInstance>& vInstances );
+	void drawMeshInstanced( unsigned int iHandle, unsigned int iFirstInstance, unsigned int iNumInstances );
+	void drawBoundMeshInstanced( unsigned int iHandle, unsigned int iFirstInstance, unsigned int iNumInstances );
 private:
 	// Singleton Implementation
 	GeometryManager();
@@ -45,5 +96,27 @@ private:
 
 	bool m_bInitialized;
 	MyGeometry m_pGeometry;	
+
+	// GPU-Resident Meshes, indexed by handle.
+	vector<MyGeometry> m_pMeshes;
+	GLuint m_iInstanceBuffer;
+	GLsizeiptr m_iInstanceCapacity;		// Bytes allocated for m_iInstanceBuffer
+	void setInstanceAttributes( GLintptr iOffset );
+	unsigned int uploadMesh( const MyMesh* pMesh );
+	unsigned int uploadMesh( const MeshFile* pFile );
+	unsigned int uploadMesh( const GLvoid* pVertices, bool bPacked, GLuint iNumVerts,
+							 const GLvoid* pIndices, GLenum eIndexType, GLuint iNumIndices );
+
+	// Cache of Unit Sphere handles keyed by their Topology and Detail.
+	map< pair< eSphereTopology, float >, unsigned int > m_pSphereMeshes;
+
+	// Meshes prepared off the main thread, waiting to be uploaded.  An empty entry is claimed and
+	//	still being built; m_pMeshPrepared is signalled when it's filled in.
+	map< pair< eSphereTopology, float >, PreparedSphere > m_pPreparedMeshes;
+	mutex m_pMeshMutex;
+	condition_variable m_pMeshPrepared;
+	void prepareSphereMesh( eSphereTopology eTopology, float fDetail );
+	PreparedSphere loadSphereMesh( eSphereTopology eTopology, float fDetail );
+	MyMesh* buildSphereMesh( eSphereTopology eTopology, float fDetail );
 };
 
@@ -1,22 +1,12 @@
 #include "GraphicsManager.h"
 #include "ShaderManager.h"
 #include "GeometryManager.h"
-#include "SceneGraph.h"
-
-// Planet Indices
-#define SUN 0
-#define EARTH 1
-#define MOON 2
-#define STARS 3
-
-#define SUN_EARTH_DIST	log(149597890.f) / LOG_BASE
-#define EARTH_MOON_DIST log(384399.f)	 / LOG_BASE
 
 // Singleton Variable initialization
 GraphicsManager* GraphicsManager::m_pInstance = NULL;
 
 // Constructor - Private, only accessable within the Graphics Manager
-GraphicsManager::GraphicsManager(GLFWwindow* rWindow)
+GraphicsManager::GraphicsManager(GLFWwindow* rWindow, const string& sSceneFile)
 {
 	// Initialize and Get Shader and Geometry Managers
 	m_pShaderMngr	= ShaderManager::getInstance();
@@ -26,42 +16,43 @@ GraphicsManager::GraphicsManager(GLFWwindow* rWindow)
 	int iHeight, iWidth;
 	glfwGetWindowSize(m_pWindow, &iWidth, &iHeight);
 
-	// Initialize SceneGraph and Build Graph
-	float fSunRadius = 8;
-	float fScaledEarthRadius = log( 6378.1f ) / LOG_BASE;
-	float fScaledMoonRadius = log( 1737.1f ) / LOG_BASE;
-	float fScaledSunRadius = log( 696000.f ) / LOG_BASE;
-	float fSunEarthRatio = fScaledSunRadius / fScaledEarthRadius;
-	float fEarthMoonRatio = fScaledEarthRadius / fScaledMoonRadius;
+	// Initialize SceneGraph and start loading the Scene: Sphere generation and Texture decoding
+	//	are spread across the pool.  Small scenes load here, large ones finish streaming in
+	//	over the following frames.
+	chrono::steady_clock::time_point mStart = chrono::steady_clock::now();
+	ThreadPool* pPool = ThreadPool::getInstance();
+	m_pSceneGraph = new SceneGraph();
+	m_pOrbits = new OrbitSystem();
+	m_pSceneLoader = new SceneLoader( m_pSceneGraph, m_pOrbits );
+	m_iNumPosedOrbits = 0;
+	m_pBodyBVH = new SphereBVH();
+	m_pRenderQueue = new RenderQueue();
+	m_pRenderDevice = new GLRenderDevice();
+	m_pClock = new SimulationClock( SIM_TIMESTEP );
+	m_dTimeScale = 1.0;
+	m_bFastForward = false;
+	m_dStepTime = 0.0;
+
+	m_pGeometryMngr->prepareSphereLODChain( UV_SPHERE, pPool );
+	m_pGeometryMngr->prepareSphereLODChain( ICO_SPHERE, pPool );
+	if ( m_pSceneLoader->open( sSceneFile, &m_pPlanets ) )
+	{
+		m_pSceneLoader->loadChunk( SCENE_LOAD_BUDGET );
+		addLoadedPlanets( 0 );
+	}
 
-	float fEarthRadius = fScaledSunRadius * fSunEarthRatio;
-	float fMoonRadius = fScaledEarthRadius * fEarthMoonRatio;
+	chrono::duration<double> mElapsed = chrono::steady_clock::now() - mStart;
+	cout << "Built " << m_pPlanets.size() << " of " << m_pSceneLoader->getNumDeclared() << " Planets in " << mElapsed.count() << "secs using " << pPool->getNumThreads() << " threads." << endl;
 
-	float fSun_EarthDist = fSunRadius + (fSunRadius * log( 149597890 ) / LOG_BASE);
-	float fEarth_MoonDist = fEarthRadius + (fEarthRadius * log( 384399 ) / LOG_BASE);
-	float fMoonYOffset = sin( log( 23.5f ) / LOG_BASE ) * fEarth_MoonDist;
-	m_pSceneGraph = new SceneGraph();
-	m_pTransformations[SUN]		= new Transformation( vec3(0,0,0) );
-	m_pTransformations[EARTH]	= new Transformation( vec3( fSun_EarthDist, 0.f, 0.f ) );
-	m_pTransformations[MOON]	= new Transformation( vec3( fEarth_MoonDist, fMoonYOffset, 0.f ) );
-	m_pSceneGraph->addTransformation( m_pTransformations[SUN], NULL );
-	m_pSceneGraph->addTransformation( m_pTransformations[EARTH], m_pTransformations[SUN] );
-	m_pSceneGraph->addTransformation( m_pTransformations[MOON], m_pTransformations[EARTH] );
-	
-	// Initialize Planets
-	m_pPlanets[SUN]		= new Planet( fSunRadius, "texture_sun.jpg", m_pTransformations[SUN], log(7.25f) / LOG_BASE, 25.38f, 0.f, false );
-	m_pPlanets[STARS]	= new Planet( ZOOM_MAX, "texture_stars.jpg", m_pTransformations[SUN], log(180.f) / LOG_BASE, 0.f, 0.f, false );
-	m_pPlanets[EARTH] = new Planet( fEarthRadius, "earth_surface.jpg", m_pTransformations[EARTH], log( 23.4f ) / LOG_BASE, 0.9972698, 365.f, true );
-	m_pPlanets[MOON] = new Planet( fMoonRadius, "texture_moon.jpg", m_pTransformations[MOON], log( 6.68f ) / LOG_BASE, 27.321582f, 27.321582f, true );
 	m_pCamera = new Camera( iHeight, iWidth );
 }
 
 // Singleton Implementations
 // Requires Window to initialize 
-GraphicsManager* GraphicsManager::getInstance(GLFWwindow *rWindow)
+GraphicsManager* GraphicsManager::getInstance(GLFWwindow *rWindow, const string& sSceneFile)
 {
 	if (NULL == m_pInstance)
-		m_pInstance = new GraphicsManager(rWindow);
+		m_pInstance = new GraphicsManager(rWindow, sSceneFile);
 
 	return m_pInstance;
 }
@@ -70,14 +61,30 @@ GraphicsManager* GraphicsManager::getInstance(GLFWwindow *rWindow)
 GraphicsManager::~GraphicsManager()
 {
 	// Destruct Assg 1
-	for ( int i = 0; i < NUM_PLANETS; ++i )
+	for ( unsigned int i = 0; i < m_pPlanets.size(); ++i )
 	{
 		if ( NULL != m_pPlanets[i] )
 			delete m_pPlanets[i];
-		
-		if ( NULL != m_pTransformations[i] )
-			delete m_pTransformations[i];
 	}	
+	m_pPlanets.clear();
+
+	if ( NULL != m_pSceneLoader )
+		delete m_pSceneLoader;
+
+	if ( NULL != m_pOrbits )
+		delete m_pOrbits;
+
+	if ( NULL != m_pClock )
+		delete m_pClock;
+
+	if ( NULL != m_pBodyBVH )
+		delete m_pBodyBVH;
+
+	if ( NULL != m_pRenderQueue )
+		delete m_pRenderQueue;
+
+	if ( NULL != m_pRenderDevice )
+		delete m_pRenderDevice;
 
 	// Let go of Window Handle
 	m_pWindow = NULL;
@@ -94,6 +101,8 @@ GraphicsManager::~GraphicsManager()
 
 	if ( NULL != m_pSceneGraph )
 		delete m_pSceneGraph;
+
+	delete ThreadPool::getInstance();
 }
 
 // Intended to be called every cycle, or when the graphics need to be updated
@@ -122,14 +131,249 @@ void GraphicsManager::RenderScene()
 	glClear( GL_COLOR_BUFFER_BIT );
 	glClear( GL_DEPTH_BUFFER_BIT );			// Clear Depth Buffer for awesomeness!
 
-	m_pShaderMngr->setCameraMatrix( m_pCamera->getToCameraMat() );
-	m_pShaderMngr->setPerspective( m_pCamera->getPerspectiveMat() );
-	m_pShaderMngr->setCameraLocation( m_pCamera->getCameraWorldPos() );
-	m_pShaderMngr->setSpecularColor( vec3( 1.0f, 1.0f, 1.0f ) );
-	m_pShaderMngr->setSpecularExp( 65.f );
+	m_pShaderMngr->setFrameUniforms( m_pCamera->getToCameraMat(), m_pCamera->getPerspectiveMat(), m_pCamera->getCameraWorldPos(),
+									 vec3( 1.0f, 1.0f, 1.0f ), 65.f );
+
+	// Keep streaming in any bodies still left in the Scene File.
+	if ( m_pSceneLoader->isLoading() )
+	{
+		unsigned int iFirstNew = m_pPlanets.size();
+		m_pSceneLoader->loadChunk( SCENE_LOAD_BUDGET );
+		addLoadedPlanets( iFirstNew );
+	}
+
+	updateScene();
+
+	// Draw between the last two steps by however far the clock is into the next one.  Only
+	//	Planets whose bounds reach into the view are touched.
+	float fAlpha = m_pClock->getAlpha();
+	m_vVisiblePlanets.clear();
+	m_pBodyBVH->queryFrustum( m_pCamera->getPerspectiveMat() * m_pCamera->getToCameraMat(), m_vVisiblePlanets );
+
+	// Record the frame's draws, then submit them sorted to minimize state changes.
+	m_pRenderDevice->beginFrame();
+	m_pRenderQueue->reset();
+#if USE_INSTANCING
+	queueInstanced( fAlpha );
+#else
+	for ( unsigned int i = 0; i < m_vVisiblePlanets.size(); ++i )
+	{
+		Planet* pPlanet = m_pPlanets[m_vVisiblePlanets[i]];
+
+		pPlanet->selectLOD( m_pCamera, fAlpha );
+		pPlanet->queueDraw( m_pRenderQueue, fAlpha, m_pCamera->getCameraWorldPos() );
+	}
+#endif
+	m_pRenderQueue->submit( m_pRenderDevice );
+	m_pRenderDevice->endFrame();
+
+	m_pShaderMngr->endFrame();
+}
+
+// Queues the visible Planets grouped by Mesh LOD and Texture, one Instanced draw per group.
+//	Every Instance is uploaded in a single buffer update before anything is drawn.
+void GraphicsManager::queueInstanced( float fAlpha )
+{
+	unsigned int iNumVisible = m_vVisiblePlanets.size();
+	vec3 vCameraPos = m_pCamera->getCameraWorldPos();
+	DrawPacket pPacket;
+
+	if ( 0 == iNumVisible )
+		return;
+
+	// Sort by (Mesh, Texture) so each group is contiguous
+	m_vDrawOrder.resize( iNumVisible );
+	for ( unsigned int i = 0; i < iNumVisible; ++i )
+	{
+		Planet* pPlanet = m_pPlanets[m_vVisiblePlanets[i]];
+
+		pPlanet->selectLOD( m_pCamera, fAlpha );
+		m_vDrawOrder[i].first = ((unsigned long long)pPlanet->getMeshHandle() << 32) | pPlanet->getTextureName();
+		m_vDrawOrder[i].second = m_vVisiblePlanets[i];
+	}
+	sort( m_vDrawOrder.begin(), m_vDrawOrder.end() );
+
+	m_vInstances.resize( iNumVisible );
+	for ( unsigned int i = 0; i < iNumVisible; ++i )
+		m_pPlanets[m_vDrawOrder[i].second]->getInstanceData( fAlpha, &m_vInstances[i] );
+	m_pRenderDevice->uploadInstances( m_vInstances );
+
+	// Groups are keyed by their nearest Instance.
+	pPacket.iProgram = m_pShaderMngr->getProgram( INSTANCED );
+	pPacket.iUniforms = INVALID_DRAW_UNIFORMS;
+	for ( unsigned int iFirst = 0, iLast = 0; iFirst < iNumVisible; iFirst = iLast )
+	{
+		unsigned long long iKey = m_vDrawOrder[iFirst].first;
+		Planet* pPlanet = m_pPlanets[m_vDrawOrder[iFirst].second];
+		float fNearest = FLT_MAX;
+
+		for ( ; iLast < iNumVisible && m_vDrawOrder[iLast].first == iKey; ++iLast )
+		{
+			const GLfloat* pToWorld = m_vInstances[iLast].fToWorld;
+			float fDistance = length( vec3( pToWorld[12], pToWorld[13], pToWorld[14] ) - vCameraPos );
+
+			fNearest = fDistance < fNearest ? fDistance : fNearest;
+		}
+
+		pPacket.iTexture = pPlanet->getTextureName();
+		pPacket.iMesh = pPlanet->getMeshHandle();
+		pPacket.iFirstInstance = iFirst;
+		pPacket.iNumInstances = iLast - iFirst;
+		pPacket.iKey = RenderQueue::makeKey( OPAQUE_LAYER, pPacket.iProgram, pPacket.iTexture, pPacket.iMesh, fNearest );
+		m_pRenderQueue->push( pPacket );
+	}
+}
+
+// Prints what the last frame's Render Queue submitted and what the Uniform Cache skipped.
+void GraphicsManager::printRenderStats()
+{
+	const RenderQueueStats& pStats = m_pRenderQueue->getStats();
+
+	cout << "Draws: " << pStats.iNumPackets
+		 << "  Program Binds: " << pStats.iProgramBinds << " (" << pStats.iProgramBindsAvoided << " avoided)"
+		 << "  Texture Binds: " << pStats.iTextureBinds << " (" << pStats.iTextureBindsAvoided << " avoided)"
+		 << "  Mesh Binds: " << pStats.iMeshBinds << " (" << pStats.iMeshBindsAvoided << " avoided)"
+		 << "  Uniform Uploads: " << m_pShaderMngr->getNumUniformUploads() << " (" << m_pShaderMngr->getNumUniformsSkipped() << " skipped)" << endl;
+}
+
+// Advances the Simulation Clock and, if it completed any fixed steps, poses the scene for the
+//	latest one.  Poses are a function of time alone, so however many steps were completed at most
+//	two are simulated: the latest, and the one before it to interpolate from.
+void GraphicsManager::updateScene()
+{
+	unsigned int iSteps = m_pClock->advance();
 
-	for ( int i = 0; i < NUM_PLANETS; ++i )
-		m_pPlanets[i]->renderPlanet();
+	if ( iSteps > 1 )
+		simulateStep( m_pClock->getTime( 1 ) / SECS_PER_SIM_UNIT );
+	if ( iSteps > 0 )
+		simulateStep( m_pClock->getTime() / SECS_PER_SIM_UNIT );
+}
+
+// Poses every Planet for dStepTime and rebuilds the World Matrices.  All orbits are evaluated in
+//	one pass up front.
+// Subtrees under the World root share no state, so for large graphs each one is posed and
+//	updated by its own job.  Planets within a subtree always run in the same order and a World
+//	Matrix is only built once its Parent's is final, so the result matches a serial update.
+void GraphicsManager::simulateStep( double dStepTime )
+{
+	ThreadPool* pPool = ThreadPool::getInstance();
+	m_dStepTime = dStepTime;
+
+	if ( m_pSceneGraph->getNumNodes() < PARALLEL_UPDATE_MIN_NODES )
+	{
+		m_pOrbits->evaluate( m_dStepTime, NULL );
+		for ( unsigned int i = 0; i < m_pPlanets.size(); ++i )
+			m_pPlanets[i]->beginStep();
+		for ( unsigned int i = 0; i < m_pPlanets.size(); ++i )
+			m_pPlanets[i]->update( m_dStepTime, m_pOrbits );
+
+		m_pSceneGraph->updateWorldMatrices( NULL );
+		refitBounds( NULL );
+		return;
+	}
+
+	m_pOrbits->evaluate( m_dStepTime, pPool );
+
+	// Small subtrees (e.g. a catalog of lone asteroids) are batched so each job has enough work.
+	unsigned int iFirst = 0, iNumNodes = 0;
+	for ( unsigned int i = 0; i < m_pSubtreeGroups.size(); ++i )
+	{
+		Transformation* pRoot = m_pSceneGraph->getTransformation( m_pSubtreeGroups[i].hRoot );
+
+		iNumNodes += NULL != pRoot ? pRoot->getSubtreeSize() : 0;
+
+		if ( iNumNodes >= SUBTREE_TASK_MIN_NODES || i + 1 == m_pSubtreeGroups.size() )
+		{
+			pPool->addJob( [this, iFirst, i, pPool]() { updateSubtreeGroups( iFirst, i, pPool ); } );
+			iFirst = i + 1;
+			iNumNodes = 0;
+		}
+	}
+	pPool->waitForAll();
+	refitBounds( pPool );
+}
+
+// Moves every Planet's Bounding Sphere to the step just simulated, then refits the BVH.
+void GraphicsManager::refitBounds( ThreadPool* pPool )
+{
+	function<void( unsigned int, unsigned int )> pGatherBounds = [this]( unsigned int iBegin, unsigned int iEnd )
+	{
+		vec3 vCenter;
+		float fRadius;
+
+		for ( unsigned int i = iBegin; i < iEnd; ++i )
+		{
+			m_pPlanets[i]->getBoundingSphere( &vCenter, &fRadius );
+			m_pBodyBVH->setSphere( i, vCenter, fRadius );
+		}
+	};
+
+	if ( NULL == pPool )
+		pGatherBounds( 0, m_pPlanets.size() );
+	else
+		pPool->parallelFor( m_pPlanets.size(), BOUNDS_PER_JOB, pGatherBounds );
+
+	m_pBodyBVH->refit();
+}
+
+// Poses then updates the subtrees of m_pSubtreeGroups[iFirst] to m_pSubtreeGroups[iLast].
+void GraphicsManager::updateSubtreeGroups( unsigned int iFirst, unsigned int iLast, ThreadPool* pPool )
+{
+	for ( unsigned int i = iFirst; i <= iLast; ++i )
+	{
+		SubtreeGroup& pGroup = m_pSubtreeGroups[i];
+		Transformation* pRoot = m_pSceneGraph->getTransformation( pGroup.hRoot );
+
+		for ( unsigned int p = 0; p < pGroup.pPlanets.size(); ++p )
+			pGroup.pPlanets[p]->beginStep();
+		for ( unsigned int p = 0; p < pGroup.pPlanets.size(); ++p )
+			pGroup.pPlanets[p]->update( m_dStepTime, m_pOrbits );
+
+		// A removed subtree has nothing left to update
+		if ( NULL != pRoot )
+			m_pSceneGraph->updateSubtree( pRoot, pPool );
+	}
+}
+
+// Poses Planets loaded since iFirstNew for the latest step, with nothing to interpolate from, adds
+//	their bounds to the BVH and groups them by their independent subtree.  Every Transformation is
+//	created by the SceneLoader along with a Planet, so every subtree ends up with a group.
+void GraphicsManager::addLoadedPlanets( unsigned int iFirstNew )
+{
+	m_pOrbits->evaluateRange( m_dStepTime, m_iNumPosedOrbits, m_pOrbits->getNumOrbits() );
+	m_iNumPosedOrbits = m_pOrbits->getNumOrbits();
+
+	for ( unsigned int i = iFirstNew; i < m_pPlanets.size(); ++i )
+		m_pPlanets[i]->update( m_dStepTime, m_pOrbits );
+
+	m_pBodyBVH->reserve( m_pSceneLoader->getNumDeclared() );
+	for ( unsigned int i = iFirstNew; i < m_pPlanets.size(); ++i )
+	{
+		vec3 vCenter;
+		float fRadius;
+
+		m_pPlanets[i]->beginStep();
+		m_pPlanets[i]->getBoundingSphere( &vCenter, &fRadius );
+		m_pBodyBVH->addSphere( vCenter, fRadius, i );
+
+		TransformHandle hRoot = m_pSceneGraph->getSubtreeRoot( m_pPlanets[i]->getTransform() );
+		map< TransformHandle, unsigned int >::iterator pIter = m_pSubtreeIndices.find( hRoot );
+
+		if ( m_pSubtreeIndices.end() == pIter )
+		{
+			pIter = m_pSubtreeIndices.insert( make_pair( hRoot, (unsigned int)m_pSubtreeGroups.size() ) ).first;
+			m_pSubtreeGroups.push_back( SubtreeGroup() );
+			m_pSubtreeGroups.back().hRoot = hRoot;
+		}
+
+		m_pSubtreeGroups[pIter->second].pPlanets.push_back( m_pPlanets[i] );
+	}
+
+	// While streaming the BVH only rebuilds once enough new bodies have piled up.
+	if ( m_pSceneLoader->isLoading() )
+		m_pBodyBVH->refit();
+	else
+		m_pBodyBVH->build();
 }
 
 // Function initializes shaders and geometry.
@@ -168,8 +412,11 @@ bool GraphicsManager::initializeGeometry()
 	GLsizeiptr iPtr;
 	void* data;
 	
-	m_pPlanets[0]->getTextureData(&iPtr, &data);
-	m_pGeometryMngr->bindTextureData(iPtr, data);
+	if ( !m_pPlanets.empty() )
+	{
+		m_pPlanets[0]->getTextureData(&iPtr, &data);
+		m_pGeometryMngr->bindTextureData(iPtr, data);
+	}
 
 	return m_pGeometryMngr->initializeGeometry();
 }
@@ -199,17 +446,17 @@ void GraphicsManager::zoomCamera( float fZoomVal )
 }
 
 // Animation Controls
-void GraphicsManager::toggleAnimation()
+// Fast-Forward is applied on top of the user's Time Scale so releasing it restores that Scale.
+void GraphicsManager::setFastForward( bool bFastForward )
 {
-	for ( int i = 0; i < NUM_PLANETS; ++i )
-		m_pPlanets[i]->toggleAnimation();
+	m_bFastForward = bFastForward;
+	m_pClock->setTimeScale( m_dTimeScale * (m_bFastForward ? FF_SPEED : 1.0) );
 }
 
-// Animation Controls
-void GraphicsManager::toggleFastForward()
+// Multiplies the user's Time Scale by dFactor, within the clock's limits.
+void GraphicsManager::scaleTime( double dFactor )
 {
-	for ( int i = 0; i < NUM_PLANETS; ++i )
-		m_pPlanets[i]->toggleFastForward();
+	m_dTimeScale *= dFactor;
+	m_dTimeScale = m_dTimeScale < MIN_TIME_SCALE ? MIN_TIME_SCALE : (m_dTimeScale > MAX_TIME_SCALE ? MAX_TIME_SCALE : m_dTimeScale);
+	setFastForward( m_bFastForward );
 }
-
-
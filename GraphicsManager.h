@@ -4,14 +4,26 @@
 #include "stdafx.h"
 #include "Camera.h"
 #include "Planet.h"
+#include "SceneGraph.h"
+#include "SceneLoader.h"
+#include "OrbitSystem.h"
+#include "SimulationClock.h"
+#include "SphereBVH.h"
+#include "RenderQueue.h"
+#include "GLRenderDevice.h"
 
 /* DEFINES */
-#define NUM_PLANETS 4
+#define DEFAULT_SCENE		"solar_system.scene"
+#define SCENE_LOAD_BUDGET	0.004	// Seconds per frame spent streaming in the Scene
+#define SIM_TIMESTEP		(1.0 / 60.0)	// Simulated seconds per fixed step
+#define SECS_PER_SIM_UNIT	40.0	// Simulated seconds per unit of Orbit and Rotation time in Scene Files
+#define FF_SPEED			50.0	// Time Scale multiplier while Fast-Forwarding
+#define BOUNDS_PER_JOB		4096	// Planet bounds gathered per job when refitting the BVH
+#define USE_INSTANCING		true	// Draw Planets sharing a Mesh and Texture in one Instanced call
 
 // Forward Declarations
 class ShaderManager;
 class GeometryManager;
-class SceneGraph;
 
 // Class: Graphics Manager
 // Purpose: Acts as the Sinew between all moving parts that are required for drawing
@@ -20,14 +32,16 @@ class SceneGraph;
 class GraphicsManager
 {
 public:
-	static GraphicsManager* getInstance(GLFWwindow *rWindow);
+	static GraphicsManager* getInstance(GLFWwindow *rWindow, const string& sSceneFile = DEFAULT_SCENE);
 	~GraphicsManager();
 
 	// Graphics Application
 	bool initializeGraphics();
 	bool renderGraphics();
-	void toggleAnimation();
-	void toggleFastForward();
+	void togglePause() { m_pClock->togglePause(); }
+	void setFastForward( bool bFastForward );
+	void scaleTime( double dFactor );
+	void printRenderStats();
 
 	/// HxW Settings
 	void resizedWindow( int iHeight, int iWidth ) { m_pCamera->updateHxW( iHeight, iWidth ); };
@@ -39,22 +53,51 @@ public:
 
 private:
 	// For Singleton Implementation
-	GraphicsManager(GLFWwindow* rWindow); 
+	GraphicsManager(GLFWwindow* rWindow, const string& sSceneFile); 
 	static GraphicsManager* m_pInstance;
 
 	// Window Reference
 	GLFWwindow* m_pWindow;
 	
 	// List of Planets for management.
-	Planet* m_pPlanets[NUM_PLANETS];
+	vector<Planet*> m_pPlanets;
 	SceneGraph* m_pSceneGraph;
-	Transformation* m_pTransformations[NUM_PLANETS];
+	SceneLoader* m_pSceneLoader;
+	OrbitSystem* m_pOrbits;
+	unsigned int m_iNumPosedOrbits;		// Orbits evaluated at least once, later ones are new
+	void addLoadedPlanets( unsigned int iFirstNew );
+
+	// Bounding Spheres of every Planet, User Data is the index in m_pPlanets.
+	SphereBVH* m_pBodyBVH;
+	vector<unsigned int> m_vVisiblePlanets;		// Frustum query results, kept to reuse its memory
+	void refitBounds( ThreadPool* pPool );
 
 	// Camera Object
 	Camera* m_pCamera;
 
 	// Render Functions
 	void RenderScene();
+	RenderQueue* m_pRenderQueue;
+	RenderDevice* m_pRenderDevice;
+	void queueInstanced( float fAlpha );
+	vector< pair< unsigned long long, unsigned int > > m_vDrawOrder;	// (Mesh, Texture) key -> m_pPlanets index
+	vector< BodyInstance > m_vInstances;								// Instances of the visible Planets in draw order
+
+	// Fixed-step Animation and Transform update, runs before anything is drawn.
+	SimulationClock* m_pClock;
+	double m_dTimeScale;			// Set by the user, Fast-Forward multiplies it
+	bool m_bFastForward;
+	double m_dStepTime;				// Orbit and Rotation time of the latest step
+	struct SubtreeGroup
+	{
+		TransformHandle hRoot;
+		vector<Planet*> pPlanets;
+	};
+	vector<SubtreeGroup> m_pSubtreeGroups;					// Planets grouped by the independent subtree they animate
+	map< TransformHandle, unsigned int > m_pSubtreeIndices;	// Subtree Root -> m_pSubtreeGroups index
+	void updateScene();
+	void simulateStep( double dStepTime );
+	void updateSubtreeGroups( unsigned int iFirst, unsigned int iLast, ThreadPool* pPool );
 
 	// Manages Shaders for all assignments
 	ShaderManager* m_pShaderMngr;
@@ -35,12 +35,53 @@
 using namespace std;
 
 // --------------------------------------------------------------------------
-// ImageMagick implementation of the InitializeTexture() function
+// Decodes the image on the calling thread, then uploads it.
+
+bool InitializeTexture(MyTexture *texture, const string &imageFileName)
+{
+    MyImage image;
+
+    return DecodeImage(&image, imageFileName) && UploadTexture(texture, image);
+}
+
+// --------------------------------------------------------------------------
+// Creates (or reuses) the texture object and sends the decoded pixels to it.
+
+bool UploadTexture(MyTexture *texture, const MyImage &image)
+{
+    if (image.pixels.empty())
+        return false;
+
+    texture->width = image.width;
+    texture->height = image.height;
+
+    // create a texture name to associate our image data with
+    if (!texture->textureName)
+        glGenTextures(1, &texture->textureName);
+
+    glBindTexture(GL_TEXTURE_2D, texture->textureName);
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+
+    // send image pixel data to OpenGL texture memory
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height,
+                 0, image.format, image.type, &image.pixels[0]);
+
+    // unbind this texture
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+// ImageMagick implementation of the DecodeImage() function
 #ifdef USING_LINUX
 
 #include <Magick++.h>
 
-bool InitializeTexture(MyTexture *texture, const string &imageFileName)
+bool DecodeImage(MyImage *image, const string &imageFileName)
 {
     Magick::Image myImage;
     
@@ -54,50 +95,38 @@ bool InitializeTexture(MyTexture *texture, const string &imageFileName)
         return false;
     }
     
-    // store the image width and height into the texture structure
-    texture->width = myImage.columns();
-    texture->height = myImage.rows();
+    // store the image width and height into the image structure
+    image->width = myImage.columns();
+    image->height = myImage.rows();
 
     // create a Magick++ pixel cache from the image for direct access to data
     Magick::Pixels pixelCache(myImage);
     Magick::PixelPacket *pixels;
-    pixels = pixelCache.get(0, 0, texture->width, texture->height);
+    pixels = pixelCache.get(0, 0, image->width, image->height);
     
     // determine the number of stored bytes per pixel channel in the cache
-    GLenum channelDataType;
     switch (sizeof(Magick::Quantum)) {
-        case 4:     channelDataType = GL_UNSIGNED_INT;      break;
-        case 2:     channelDataType = GL_UNSIGNED_SHORT;    break;
-        default:    channelDataType = GL_UNSIGNED_BYTE;
+        case 4:     image->type = GL_UNSIGNED_INT;      break;
+        case 2:     image->type = GL_UNSIGNED_SHORT;    break;
+        default:    image->type = GL_UNSIGNED_BYTE;
     }
-    
-    // create a texture name to associate our image data with
-    if (!texture->textureName)
-        glGenTextures(1, &texture->textureName);
-    
-    // bind the texture as a "rectangle" to access using image pixel coordinates
-    glBindTexture(GL_TEXTURE_2D, texture->textureName);
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    image->format = GL_BGRA;
 
-    // send image pixel data to OpenGL texture memory
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture->width, texture->height,
-                 0, GL_BGRA, channelDataType, pixels);
-    
-    // unbind this texture
-    glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+    // copy the pixels out of the cache, it is released with myImage
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(pixels);
+    image->pixels.assign(bytes, bytes + sizeof(Magick::PixelPacket) * image->width * image->height);
     
     return true;
 }
 
 #endif
 // --------------------------------------------------------------------------
-// FreeImage implementation of the InitializeTexture() function
+// FreeImage implementation of the DecodeImage() function
 #ifdef USING_WINDOWS
 
 #include "FreeImage.h"
 
-bool InitializeTexture(MyTexture *mytex, const string &imageFileName)
+bool DecodeImage(MyImage *image, const string &imageFileName)
 {
 	FREE_IMAGE_FORMAT fif = FIF_UNKNOWN;
 	FIBITMAP* dib = nullptr;
@@ -115,19 +144,18 @@ bool InitializeTexture(MyTexture *mytex, const string &imageFileName)
 		return false;
 
 	bits = FreeImage_GetBits(dib);
-	mytex->width = FreeImage_GetWidth(dib);
-	mytex->height = FreeImage_GetHeight(dib);
-	if ((bits == 0) || (mytex->width == 0) || (mytex->height == 0))
+	image->width = FreeImage_GetWidth(dib);
+	image->height = FreeImage_GetHeight(dib);
+	if ((bits == 0) || (image->width == 0) || (image->height == 0))
+	{
+		FreeImage_Unload(dib);
 		return false;
+	}
 
-	glGenTextures(1, &mytex->textureName);
-	glBindTexture(GL_TEXTURE_2D, mytex->textureName);
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, mytex->width, mytex->height,
-		0, GL_BGR, GL_UNSIGNED_BYTE, bits);
+	// rows are padded to 4 bytes, matching OpenGL's default unpack alignment
+	image->format = GL_BGR;
+	image->type = GL_UNSIGNED_BYTE;
+	image->pixels.assign(bits, bits + FreeImage_GetPitch(dib) * image->height);
 
 	FreeImage_Unload(dib);
 
@@ -18,6 +18,7 @@
 #define __IMAGE_READER_H__
 
 #include <string>
+#include <vector>
 
 // --------------------------------------------------------------------------
 // A structure to hold an allocated OpenGL texture along with its dimensions.
@@ -35,11 +36,32 @@ struct MyTexture
     {}
 };
 
+// --------------------------------------------------------------------------
+// A decoded image held in system memory, ready to be handed to OpenGL.
+
+struct MyImage
+{
+    // raw pixel rows as read from the file, in the given format and type
+    std::vector<unsigned char> pixels;
+    GLuint  width, height;
+    GLenum  format, type;
+
+    MyImage() : width(0), height(0), format(0), type(0)
+    {}
+};
+
 // --------------------------------------------------------------------------
 // Prototype for a function that loads an image with a given file name into
 // an instance of the above structure. Returns true if successful.
 
 bool InitializeTexture(MyTexture *texture, const std::string &imageFileName);
 
+// --------------------------------------------------------------------------
+// The two halves of InitializeTexture(). DecodeImage() makes no OpenGL calls
+// and may run on any thread; UploadTexture() must run on the context thread.
+
+bool DecodeImage(MyImage *image, const std::string &imageFileName);
+bool UploadTexture(MyTexture *texture, const MyImage &image);
+
 // --------------------------------------------------------------------------
 #endif
@@ -0,0 +1,258 @@
+#include "MatrixKernel.h"
+
+// SIMD Availability: kernels are compiled per function with target attributes (GCC/Clang) or
+//	freely (MSVC), so the build doesn't need -mavx2 and the binary still runs on older CPUs.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MATRIX_KERNEL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define KERNEL_TARGET( sISA )
+#else
+#define KERNEL_TARGET( sISA ) __attribute__(( target( sISA ) ))
+#endif
+#endif
+
+#define NO_PARENT			0xFFFFFFFF
+#define XCR0_AVX_STATE		0x06		// XMM and YMM state enabled by the OS
+#define XCR0_AVX512_STATE	0xE6		// ... plus opmask and ZMM state
+
+// Batch Kernel Signatures
+typedef void (*MultiplyArrayFunc)( const mat4* pLHS, const mat4* pRHS, mat4* pOut, unsigned int iCount );
+typedef void (*PropagateFunc)( const unsigned int* pParents, const mat4* pLocals, mat4* pWorlds, unsigned int iCount );
+
+// Batch loops around a single-matrix kernel, compiled for the kernel's instruction set so the
+//	kernel inlines into them.
+#define DEFINE_BATCH_KERNELS( Target, Suffix )																			\
+	Target																												\
+	static void multiplyArray##Suffix( const mat4* pLHS, const mat4* pRHS, mat4* pOut, unsigned int iCount )			\
+	{																													\
+		for ( unsigned int i = 0; i < iCount; ++i )																		\
+			multiply##Suffix( &pLHS[i][0][0], &pRHS[i][0][0], &pOut[i][0][0] );											\
+	}																													\
+	Target																												\
+	static void propagate##Suffix( const unsigned int* pParents, const mat4* pLocals, mat4* pWorlds, unsigned int iCount )	\
+	{																													\
+		for ( unsigned int i = 0; i < iCount; ++i )																		\
+		{																												\
+			if ( NO_PARENT == pParents[i] )																				\
+				pWorlds[i] = pLocals[i];																				\
+			else																										\
+				multiply##Suffix( &pWorlds[pParents[i]][0][0], &pLocals[i][0][0], &pWorlds[i][0][0] );					\
+		}																												\
+	}
+
+// Names for reporting
+const char* c_pKernelNames[MAX_MATRIX_KERNELS] = { "scalar", "sse", "avx2", "avx512" };
+
+/************************************************************************\
+ * Kernels: each computes one column-major 4x4 product, Out = LHS * RHS.*
+ * Column c of Out is the LHS columns weighted by column c of RHS.      *
+\************************************************************************/
+
+// glm reference
+static inline void multiplyScalar( const float* pLHS, const float* pRHS, float* pOut )
+{
+	mat4 mResult = *(const mat4*)pLHS * *(const mat4*)pRHS;
+	memcpy( pOut, &mResult[0][0], sizeof( mat4 ) );
+}
+
+DEFINE_BATCH_KERNELS( , Scalar )
+
+#ifdef MATRIX_KERNEL_X86
+// One result column per instruction.
+KERNEL_TARGET( "sse2" )
+static inline void multiplySSE( const float* pLHS, const float* pRHS, float* pOut )
+{
+	__m128 vL0 = _mm_loadu_ps( pLHS ), vL1 = _mm_loadu_ps( pLHS + 4 );
+	__m128 vL2 = _mm_loadu_ps( pLHS + 8 ), vL3 = _mm_loadu_ps( pLHS + 12 );
+	__m128 vCols[4];
+
+	// Results are held until every column is done so pOut may alias pLHS or pRHS
+	for ( unsigned int c = 0; c < 4; ++c )
+	{
+		const float* pCol = pRHS + (c * 4);
+		vCols[c] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( vL0, _mm_set1_ps( pCol[0] ) ), _mm_mul_ps( vL1, _mm_set1_ps( pCol[1] ) ) ),
+							   _mm_add_ps( _mm_mul_ps( vL2, _mm_set1_ps( pCol[2] ) ), _mm_mul_ps( vL3, _mm_set1_ps( pCol[3] ) ) ) );
+	}
+
+	for ( unsigned int c = 0; c < 4; ++c )
+		_mm_storeu_ps( pOut + (c * 4), vCols[c] );
+}
+
+// Two result columns per instruction: LHS columns are duplicated into both 128-bit lanes and
+//	each lane picks its weights from its own RHS column.
+KERNEL_TARGET( "avx2,fma" )
+static inline void multiplyAVX2( const float* pLHS, const float* pRHS, float* pOut )
+{
+	__m256 vL0 = _mm256_broadcast_ps( (const __m128*)pLHS ), vL1 = _mm256_broadcast_ps( (const __m128*)(pLHS + 4) );
+	__m256 vL2 = _mm256_broadcast_ps( (const __m128*)(pLHS + 8) ), vL3 = _mm256_broadcast_ps( (const __m128*)(pLHS + 12) );
+	__m256 vR01 = _mm256_loadu_ps( pRHS ), vR23 = _mm256_loadu_ps( pRHS + 8 );
+	__m256 vOut01, vOut23;
+
+	vOut01 = _mm256_mul_ps( vL0, _mm256_permute_ps( vR01, 0x00 ) );
+	vOut01 = _mm256_fmadd_ps( vL1, _mm256_permute_ps( vR01, 0x55 ), vOut01 );
+	vOut01 = _mm256_fmadd_ps( vL2, _mm256_permute_ps( vR01, 0xAA ), vOut01 );
+	vOut01 = _mm256_fmadd_ps( vL3, _mm256_permute_ps( vR01, 0xFF ), vOut01 );
+
+	vOut23 = _mm256_mul_ps( vL0, _mm256_permute_ps( vR23, 0x00 ) );
+	vOut23 = _mm256_fmadd_ps( vL1, _mm256_permute_ps( vR23, 0x55 ), vOut23 );
+	vOut23 = _mm256_fmadd_ps( vL2, _mm256_permute_ps( vR23, 0xAA ), vOut23 );
+	vOut23 = _mm256_fmadd_ps( vL3, _mm256_permute_ps( vR23, 0xFF ), vOut23 );
+
+	_mm256_storeu_ps( pOut, vOut01 );
+	_mm256_storeu_ps( pOut + 8, vOut23 );
+}
+
+// The whole result per instruction: four lanes, one per result column.
+KERNEL_TARGET( "avx512f" )
+static inline void multiplyAVX512( const float* pLHS, const float* pRHS, float* pOut )
+{
+	__m512 vRHS = _mm512_loadu_ps( pRHS );
+	__m512 vOut;
+
+	vOut = _mm512_mul_ps( _mm512_broadcast_f32x4( _mm_loadu_ps( pLHS ) ), _mm512_permute_ps( vRHS, 0x00 ) );
+	vOut = _mm512_fmadd_ps( _mm512_broadcast_f32x4( _mm_loadu_ps( pLHS + 4 ) ), _mm512_permute_ps( vRHS, 0x55 ), vOut );
+	vOut = _mm512_fmadd_ps( _mm512_broadcast_f32x4( _mm_loadu_ps( pLHS + 8 ) ), _mm512_permute_ps( vRHS, 0xAA ), vOut );
+	vOut = _mm512_fmadd_ps( _mm512_broadcast_f32x4( _mm_loadu_ps( pLHS + 12 ) ), _mm512_permute_ps( vRHS, 0xFF ), vOut );
+
+	_mm512_storeu_ps( pOut, vOut );
+}
+
+DEFINE_BATCH_KERNELS( KERNEL_TARGET( "sse2" ), SSE )
+DEFINE_BATCH_KERNELS( KERNEL_TARGET( "avx2,fma" ), AVX2 )
+DEFINE_BATCH_KERNELS( KERNEL_TARGET( "avx512f" ), AVX512 )
+#endif
+
+/************************************************************************\
+ * Dispatch                                                             *
+\************************************************************************/
+
+// Queries the CPU (and OS register state) for each instruction set.
+static void detectKernels( bool* pSupported )
+{
+	pSupported[MATRIX_KERNEL_SCALAR] = true;
+	pSupported[MATRIX_KERNEL_SSE] = false;
+	pSupported[MATRIX_KERNEL_AVX2] = false;
+	pSupported[MATRIX_KERNEL_AVX512] = false;
+
+#if defined(MATRIX_KERNEL_X86) && defined(_MSC_VER)
+	int pInfo[4];
+	unsigned long long iXCR0 = 0;
+	bool bOSXSave;
+
+	__cpuid( pInfo, 0 );
+	int iMaxLeaf = pInfo[0];
+
+	__cpuid( pInfo, 1 );
+	pSupported[MATRIX_KERNEL_SSE] = 0 != (pInfo[3] & (1 << 26));
+	bOSXSave = 0 != (pInfo[2] & (1 << 27));
+	bool bFMA = 0 != (pInfo[2] & (1 << 12));
+	if ( bOSXSave )
+		iXCR0 = _xgetbv( 0 );
+
+	if ( iMaxLeaf >= 7 )
+	{
+		__cpuidex( pInfo, 7, 0 );
+		pSupported[MATRIX_KERNEL_AVX2] = bFMA && 0 != (pInfo[1] & (1 << 5)) && XCR0_AVX_STATE == (iXCR0 & XCR0_AVX_STATE);
+		pSupported[MATRIX_KERNEL_AVX512] = 0 != (pInfo[1] & (1 << 16)) && XCR0_AVX512_STATE == (iXCR0 & XCR0_AVX512_STATE);
+	}
+#elif defined(MATRIX_KERNEL_X86)
+	// GCC/Clang check the OS register state as part of these
+	__builtin_cpu_init();
+	pSupported[MATRIX_KERNEL_SSE] = 0 != __builtin_cpu_supports( "sse2" );
+	pSupported[MATRIX_KERNEL_AVX2] = 0 != __builtin_cpu_supports( "avx2" ) && 0 != __builtin_cpu_supports( "fma" );
+	pSupported[MATRIX_KERNEL_AVX512] = 0 != __builtin_cpu_supports( "avx512f" );
+#endif
+}
+
+// Detection results, filled once on first use (function statics are thread-safe to initialize).
+struct KernelSupport
+{
+	bool pSupported[MAX_MATRIX_KERNELS];
+
+	KernelSupport()
+	{
+		detectKernels( pSupported );
+	}
+};
+
+static const bool* getSupportedKernels()
+{
+	static KernelSupport s_pSupport;
+
+	return s_pSupport.pSupported;
+}
+
+// Resolves MAX_MATRIX_KERNELS or an unsupported kernel to the best one this CPU supports.
+static eMatrixKernel resolveKernel( eMatrixKernel eKernel )
+{
+	if ( MAX_MATRIX_KERNELS == eKernel || !IsMatrixKernelSupported( eKernel ) )
+		eKernel = GetBestMatrixKernel();
+
+	return eKernel;
+}
+
+// Widest supported instruction set.
+eMatrixKernel GetBestMatrixKernel()
+{
+	const bool* pSupported = getSupportedKernels();
+	int iReturn = MAX_MATRIX_KERNELS - 1;
+
+	while ( iReturn > MATRIX_KERNEL_SCALAR && !pSupported[iReturn] )
+		--iReturn;
+
+	return (eMatrixKernel)iReturn;
+}
+
+// Whether this CPU can run a given kernel.
+bool IsMatrixKernelSupported( eMatrixKernel eKernel )
+{
+	return eKernel < MAX_MATRIX_KERNELS && getSupportedKernels()[eKernel];
+}
+
+// Short name of a kernel, e.g. "avx2".
+const char* GetMatrixKernelName( eMatrixKernel eKernel )
+{
+	return eKernel < MAX_MATRIX_KERNELS ? c_pKernelNames[eKernel] : "best";
+}
+
+/************************************************************************\
+ * Batch Operations                                                     *
+\************************************************************************/
+
+// Element-wise product of two matrix arrays.
+void MultiplyMatrices( const mat4* pLHS, const mat4* pRHS, mat4* pOut, unsigned int iCount, eMatrixKernel eKernel )
+{
+	MultiplyArrayFunc pMultiply = multiplyArrayScalar;
+
+#ifdef MATRIX_KERNEL_X86
+	switch ( resolveKernel( eKernel ) )
+	{
+		case MATRIX_KERNEL_SSE:		pMultiply = multiplyArraySSE;		break;
+		case MATRIX_KERNEL_AVX2:	pMultiply = multiplyArrayAVX2;		break;
+		case MATRIX_KERNEL_AVX512:	pMultiply = multiplyArrayAVX512;	break;
+		default:					break;
+	}
+#endif
+
+	pMultiply( pLHS, pRHS, pOut, iCount );
+}
+
+// Forward sweep, parents are always final before their children read them.
+void PropagateWorldMatrices( const unsigned int* pParents, const mat4* pLocals, mat4* pWorlds, unsigned int iCount, eMatrixKernel eKernel )
+{
+	PropagateFunc pPropagate = propagateScalar;
+
+#ifdef MATRIX_KERNEL_X86
+	switch ( resolveKernel( eKernel ) )
+	{
+		case MATRIX_KERNEL_SSE:		pPropagate = propagateSSE;		break;
+		case MATRIX_KERNEL_AVX2:	pPropagate = propagateAVX2;		break;
+		case MATRIX_KERNEL_AVX512:	pPropagate = propagateAVX512;	break;
+		default:					break;
+	}
+#endif
+
+	pPropagate( pParents, pLocals, pWorlds, iCount );
+}
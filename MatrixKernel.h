@@ -0,0 +1,34 @@
+#pragma once
+#include "stdafx.h"
+
+// Instruction Sets with a Matrix Kernel, in order of preference.
+enum eMatrixKernel
+{
+	MATRIX_KERNEL_SCALAR = 0,	// glm
+	MATRIX_KERNEL_SSE,
+	MATRIX_KERNEL_AVX2,			// Two result columns per instruction
+	MATRIX_KERNEL_AVX512,		// Whole result matrix per instruction
+	MAX_MATRIX_KERNELS			// As an argument: use the best kernel this CPU supports
+};
+
+// --------------------------------------------------------------------------
+// Runtime Dispatch: the kernels are all compiled in, the CPU is queried once on
+// first use to decide which can run.
+
+eMatrixKernel GetBestMatrixKernel();
+bool IsMatrixKernelSupported( eMatrixKernel eKernel );
+const char* GetMatrixKernelName( eMatrixKernel eKernel );
+
+// --------------------------------------------------------------------------
+// pOut[i] = pLHS[i] * pRHS[i] for every i below iCount.  pOut may alias either input.
+
+void MultiplyMatrices( const mat4* pLHS, const mat4* pRHS, mat4* pOut, unsigned int iCount,
+					   eMatrixKernel eKernel = MAX_MATRIX_KERNELS );
+
+// --------------------------------------------------------------------------
+// World Matrix propagation over parent-before-child arrays:
+//	pWorlds[i] = pWorlds[pParents[i]] * pLocals[i], or pLocals[i] when pParents[i] is 0xFFFFFFFF.
+// Every parent index must be less than its child's.
+
+void PropagateWorldMatrices( const unsigned int* pParents, const mat4* pLocals, mat4* pWorlds, unsigned int iCount,
+							 eMatrixKernel eKernel = MAX_MATRIX_KERNELS );
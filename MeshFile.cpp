@@ -0,0 +1,235 @@
+#include "MeshFile.h"
+
+#ifdef USING_WINDOWS
+#define NOMINMAX
+#include <windows.h>
+#endif
+#ifdef USING_LINUX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Definitions
+#define MESH_CACHE_PREFIX	"sphere_"
+#define MESH_CACHE_EXT		".mesh"
+#define BLOB_ALIGNMENT		16
+
+// Numbers the temporary files written by this process.
+static atomic<unsigned int> g_iNumTempFiles( 0 );
+
+// Topology names used in cache file names.
+const char* c_pTopologyFileNames[MAX_TOPOLOGIES] = { "uv", "ico", "cube" };
+
+// Rounds an offset up to the next blob boundary.
+static GLuint alignOffset( GLuint iOffset )
+{
+	return (iOffset + BLOB_ALIGNMENT - 1) & ~(GLuint)(BLOB_ALIGNMENT - 1);
+}
+
+// Constructor
+MeshFile::MeshFile()
+{
+	m_pData = NULL;
+	m_iSize = 0;
+	m_pHeader = NULL;
+	m_pFileHandle = NULL;
+	m_pMappingHandle = NULL;
+}
+
+// Destructor
+MeshFile::~MeshFile()
+{
+	close();
+}
+
+/************************************************************************\
+ * Mapping                                                              *
+\************************************************************************/
+
+// Maps the whole file read-only and checks that the header describes a complete mesh of this version.
+bool MeshFile::open( const string& sFileName )
+{
+	bool bValid;
+
+	close();
+
+#ifdef USING_WINDOWS
+	HANDLE pFile = CreateFileA( sFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	LARGE_INTEGER iFileSize;
+
+	if ( INVALID_HANDLE_VALUE == pFile )
+		return false;
+	m_pFileHandle = pFile;
+
+	if ( !GetFileSizeEx( pFile, &iFileSize ) || iFileSize.QuadPart < (LONGLONG)sizeof( MeshFileHeader ) )
+	{
+		close();
+		return false;
+	}
+	m_iSize = (size_t)iFileSize.QuadPart;
+
+	m_pMappingHandle = CreateFileMappingA( pFile, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( NULL != m_pMappingHandle )
+		m_pData = (const unsigned char*)MapViewOfFile( m_pMappingHandle, FILE_MAP_READ, 0, 0, 0 );
+#endif
+#ifdef USING_LINUX
+	int iFile = ::open( sFileName.c_str(), O_RDONLY );
+	struct stat pStat;
+	void* pMapping;
+
+	if ( -1 == iFile )
+		return false;
+
+	if ( 0 == fstat( iFile, &pStat ) && pStat.st_size >= (off_t)sizeof( MeshFileHeader ) )
+	{
+		m_iSize = (size_t)pStat.st_size;
+		pMapping = mmap( NULL, m_iSize, PROT_READ, MAP_PRIVATE, iFile, 0 );
+		if ( MAP_FAILED != pMapping )
+			m_pData = (const unsigned char*)pMapping;
+	}
+
+	// The mapping keeps the file alive on its own
+	::close( iFile );
+#endif
+
+	if ( NULL == m_pData )
+	{
+		close();
+		return false;
+	}
+
+	m_pHeader = (const MeshFileHeader*)m_pData;
+	bValid = MESH_FILE_MAGIC == m_pHeader->iMagic &&
+			 MESH_FILE_VERSION == m_pHeader->iVersion &&
+			 m_iSize == m_pHeader->iFileSize &&
+			 m_pHeader->iVertexOffset + (size_t)m_pHeader->iVertexStride * m_pHeader->iNumVerts <= m_iSize &&
+			 m_pHeader->iIndexOffset + (size_t)(GL_UNSIGNED_SHORT == m_pHeader->iIndexType ? sizeof( GLushort ) : sizeof( GLuint )) * m_pHeader->iNumIndices <= m_iSize;
+
+	if ( !bValid )
+		close();
+
+	return bValid;
+}
+
+// Unmaps the file, every pointer handed out is invalid afterwards.
+void MeshFile::close()
+{
+#ifdef USING_WINDOWS
+	if ( NULL != m_pData )
+		UnmapViewOfFile( m_pData );
+	if ( NULL != m_pMappingHandle )
+		CloseHandle( m_pMappingHandle );
+	if ( NULL != m_pFileHandle )
+		CloseHandle( m_pFileHandle );
+#endif
+#ifdef USING_LINUX
+	if ( NULL != m_pData )
+		munmap( (void*)m_pData, m_iSize );
+#endif
+
+	m_pData = NULL;
+	m_iSize = 0;
+	m_pHeader = NULL;
+	m_pFileHandle = NULL;
+	m_pMappingHandle = NULL;
+}
+
+// Whether the mapped mesh was generated with the given parameters in the given vertex format.
+bool MeshFile::matches( eSphereTopology eTopology, float fDetail, bool bPacked ) const
+{
+	GLuint iFormat = bPacked ? MESH_FORMAT_PACKED : MESH_FORMAT_FLOAT;
+	GLuint iStride = bPacked ? sizeof( PackedSphereVertex ) : sizeof( SphereVertex );
+
+	return NULL != m_pHeader &&
+		   (GLuint)eTopology == m_pHeader->iTopology &&
+		   fDetail == m_pHeader->fDetail &&
+		   iFormat == m_pHeader->iVertexFormat &&
+		   iStride == m_pHeader->iVertexStride;
+}
+
+/************************************************************************\
+ * Writing and Naming                                                   *
+\************************************************************************/
+
+// Writes a mesh in its upload layout: packed vertices if present and 16-bit indices when every
+// vertex fits.  The file is written under a temporary name and renamed so readers never see
+// a partial file.
+bool MeshFile::write( const string& sFileName, eSphereTopology eTopology, float fDetail, const MyMesh* pMesh )
+{
+	bool bPacked = !pMesh->vPackedVertices.empty();
+	bool bShortIndices = pMesh->iNumVerts <= USHRT_MAX + 1;
+	const char* pVertices = bPacked ? (const char*)&pMesh->vPackedVertices[0] : (const char*)&pMesh->vVertices[0];
+	vector<GLushort> vShortIndices;
+	ostringstream pTempName;
+	string sTempName;
+	MeshFileHeader pHeader;
+	const char cPadding[BLOB_ALIGNMENT] = { 0 };
+
+	pHeader.iMagic = MESH_FILE_MAGIC;
+	pHeader.iVersion = MESH_FILE_VERSION;
+	pHeader.iTopology = eTopology;
+	pHeader.fDetail = fDetail;
+	pHeader.iVertexFormat = bPacked ? MESH_FORMAT_PACKED : MESH_FORMAT_FLOAT;
+	pHeader.iVertexStride = bPacked ? sizeof( PackedSphereVertex ) : sizeof( SphereVertex );
+	pHeader.iNumVerts = pMesh->iNumVerts;
+	pHeader.iVertexOffset = alignOffset( sizeof( MeshFileHeader ) );
+	pHeader.iIndexType = bShortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	pHeader.iNumIndices = pMesh->vIndices.size();
+	pHeader.iIndexOffset = alignOffset( pHeader.iVertexOffset + pHeader.iVertexStride * pHeader.iNumVerts );
+	pHeader.iFileSize = pHeader.iIndexOffset + pHeader.iNumIndices * (bShortIndices ? sizeof( GLushort ) : sizeof( GLuint ));
+
+	// Unique per process and per write, so concurrent writers never share a temporary file.
+#ifdef USING_WINDOWS
+	pTempName << sFileName << "." << GetCurrentProcessId() << "." << g_iNumTempFiles++ << ".tmp";
+#else
+	pTempName << sFileName << "." << getpid() << "." << g_iNumTempFiles++ << ".tmp";
+#endif
+	sTempName = pTempName.str();
+
+	if ( bShortIndices )
+		vShortIndices.assign( pMesh->vIndices.begin(), pMesh->vIndices.end() );
+
+	ofstream pOut( sTempName.c_str(), ios::out | ios::binary | ios::trunc );
+	if ( !pOut.is_open() )
+		return false;
+
+	pOut.write( (const char*)&pHeader, sizeof( MeshFileHeader ) );
+	pOut.write( cPadding, pHeader.iVertexOffset - sizeof( MeshFileHeader ) );
+	pOut.write( pVertices, pHeader.iVertexStride * pHeader.iNumVerts );
+	pOut.write( cPadding, pHeader.iIndexOffset - (pHeader.iVertexOffset + pHeader.iVertexStride * pHeader.iNumVerts) );
+	if ( bShortIndices )
+		pOut.write( (const char*)&vShortIndices[0], sizeof( GLushort ) * vShortIndices.size() );
+	else
+		pOut.write( (const char*)&pMesh->vIndices[0], sizeof( GLuint ) * pMesh->vIndices.size() );
+	pOut.close();
+
+	if ( pOut.fail() )
+	{
+		remove( sTempName.c_str() );
+		return false;
+	}
+
+	// Replaces any existing file in one step, readers see either the old or the new file.
+#ifdef USING_WINDOWS
+	if ( !MoveFileExA( sTempName.c_str(), sFileName.c_str(), MOVEFILE_REPLACE_EXISTING ) )
+#else
+	if ( 0 != rename( sTempName.c_str(), sFileName.c_str() ) )
+#endif
+	{
+		remove( sTempName.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+// Cache file name for a Sphere, e.g. sphere_ico_5.mesh
+string MeshFile::getSphereFileName( eSphereTopology eTopology, float fDetail )
+{
+	char cDetail[32];
+
+	snprintf( cDetail, sizeof( cDetail ), "%g", fDetail );
+	return string( MESH_CACHE_PREFIX ) + c_pTopologyFileNames[eTopology] + "_" + cDetail + MESH_CACHE_EXT;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+/* INCLUDES */
+#include "stdafx.h"
+#include "MeshGenerator.h"
+
+// Definitions
+#define MESH_FILE_MAGIC		0x4853454D	// "MESH"
+#define MESH_FILE_VERSION	1			// Bump whenever a generator's output changes to invalidate old caches.
+#define MESH_FORMAT_FLOAT	0			// Vertices are SphereVertex
+#define MESH_FORMAT_PACKED	1			// Vertices are PackedSphereVertex
+
+// Mesh File Header
+// Sits at the start of every .mesh file, followed by the vertex and index blobs at the
+//	given offsets.  Blobs are stored exactly as they're uploaded to the GPU.
+struct MeshFileHeader
+{
+	GLuint iMagic;
+	GLuint iVersion;
+
+	// Generator Key
+	GLuint iTopology;
+	GLfloat fDetail;
+
+	// Vertex Blob
+	GLuint iVertexFormat;
+	GLuint iVertexStride;
+	GLuint iNumVerts;
+	GLuint iVertexOffset;
+
+	// Index Blob
+	GLuint iIndexType;		// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	GLuint iNumIndices;
+	GLuint iIndexOffset;
+
+	GLuint iFileSize;
+};
+
+// Class: MeshFile
+// Purpose: A read-only, memory-mapped .mesh file.  The vertex and index pointers point
+//			straight into the mapping and stay valid until the file is closed.
+class MeshFile
+{
+public:
+	MeshFile();
+	~MeshFile();
+
+	// Maps and validates a file, returns false if it's missing, truncated or from another version.
+	bool open( const string& sFileName );
+	void close();
+	bool matches( eSphereTopology eTopology, float fDetail, bool bPacked ) const;
+
+	// Mapped Data
+	const MeshFileHeader* getHeader() const { return m_pHeader; }
+	const GLvoid* getVertices() const { return m_pData + m_pHeader->iVertexOffset; }
+	const GLvoid* getIndices() const { return m_pData + m_pHeader->iIndexOffset; }
+
+	// Writing and Naming
+	static bool write( const string& sFileName, eSphereTopology eTopology, float fDetail, const MyMesh* pMesh );
+	static string getSphereFileName( eSphereTopology eTopology, float fDetail );
+
+private:
+	MeshFile( const MeshFile& pCopy );	// Don't allow use of Copy Constructor
+
+	const unsigned char* m_pData;
+	size_t m_iSize;
+	const MeshFileHeader* m_pHeader;
+
+	// Platform Handles for the Mapping
+	void* m_pFileHandle;
+	void* m_pMappingHandle;
+};
@@ -0,0 +1,720 @@
+﻿#include "MeshGenerator.h"
+
+// SIMD Selection: widest instruction set enabled at compile time, scalar otherwise.
+#if defined(__AVX2__) || defined(__AVX__)
+#include <immintrin.h>
+#define SPHERE_SIMD_AVX
+#define SPHERE_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPHERE_SIMD_SSE
+#define SPHERE_SIMD_WIDTH 4
+#else
+#define SPHERE_SIMD_WIDTH 1
+#endif
+
+#define PI 3.14159265f
+#define UNIT_RADIUS 1.f
+#define MAX_THETA_DEGS 360.f
+#define MAX_PHI_DEGS 180.f
+#define SNORM16_MAX 32767.f
+#define UNORM16_MAX 65535.f
+
+#define POLE_EPSILON 1e-6f
+#define ICO_LATITUDE_Y 0.4472135955f	// sin( atan( 1/2 ) ), height of the icosahedron's rings
+#define ICO_RING_RADIUS 0.894427191f	// cos( atan( 1/2 ) )
+
+// Vertex Cache Optimization (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+#define CACHE_DECAY_POWER		1.5f
+#define LAST_TRI_SCORE			0.75f
+#define VALENCE_BOOST_SCALE		2.f
+#define VALENCE_BOOST_POWER		0.5f
+
+// Sphere Grid: every vertex between the poles, stored ring by ring in Structure of Arrays
+// form so the cartesian coordinates of a ring can be written in bulk.
+struct SphereGrid
+{
+	vector<GLfloat> vX, vY, vZ;		// Cartesian Coordinates
+	vector<GLfloat> vPhi, vTheta;	// Spherical Coordinates in degrees
+	unsigned int iRings, iMeridians;
+	float fThetaStep;				// Degrees between Meridians, 360 / iMeridians
+};
+
+// Writes the X and Z coordinates of one ring of the grid.  Y is constant for the ring.
+//	X = r·sinϕ·sinθ, Z = r·sinϕ·cosθ, both snapped to 0 under FLT_EPSILON.
+static void generateRing( float fSinPhi, const float* pSinTheta, const float* pCosTheta,
+						  unsigned int iCount, float* pX, float* pZ, bool bVectorized )
+{
+	unsigned int t = 0;
+	float fX, fZ;
+
+#if defined(SPHERE_SIMD_AVX)
+	if ( bVectorized )
+	{
+		__m256 vSinPhi = _mm256_set1_ps( fSinPhi );
+		__m256 vEpsilon = _mm256_set1_ps( FLT_EPSILON );
+		__m256 vAbsMask = _mm256_castsi256_ps( _mm256_set1_epi32( 0x7fffffff ) );
+		__m256 vX, vZ;
+
+		for ( ; t + SPHERE_SIMD_WIDTH <= iCount; t += SPHERE_SIMD_WIDTH )
+		{
+			vX = _mm256_mul_ps( vSinPhi, _mm256_loadu_ps( pSinTheta + t ) );
+			vZ = _mm256_mul_ps( vSinPhi, _mm256_loadu_ps( pCosTheta + t ) );
+			vX = _mm256_andnot_ps( _mm256_cmp_ps( _mm256_and_ps( vX, vAbsMask ), vEpsilon, _CMP_LT_OQ ), vX );
+			vZ = _mm256_andnot_ps( _mm256_cmp_ps( _mm256_and_ps( vZ, vAbsMask ), vEpsilon, _CMP_LT_OQ ), vZ );
+			_mm256_storeu_ps( pX + t, vX );
+			_mm256_storeu_ps( pZ + t, vZ );
+		}
+	}
+#elif defined(SPHERE_SIMD_SSE)
+	if ( bVectorized )
+	{
+		__m128 vSinPhi = _mm_set1_ps( fSinPhi );
+		__m128 vEpsilon = _mm_set1_ps( FLT_EPSILON );
+		__m128 vAbsMask = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+		__m128 vX, vZ;
+
+		for ( ; t + SPHERE_SIMD_WIDTH <= iCount; t += SPHERE_SIMD_WIDTH )
+		{
+			vX = _mm_mul_ps( vSinPhi, _mm_loadu_ps( pSinTheta + t ) );
+			vZ = _mm_mul_ps( vSinPhi, _mm_loadu_ps( pCosTheta + t ) );
+			vX = _mm_andnot_ps( _mm_cmplt_ps( _mm_and_ps( vX, vAbsMask ), vEpsilon ), vX );
+			vZ = _mm_andnot_ps( _mm_cmplt_ps( _mm_and_ps( vZ, vAbsMask ), vEpsilon ), vZ );
+			_mm_storeu_ps( pX + t, vX );
+			_mm_storeu_ps( pZ + t, vZ );
+		}
+	}
+#endif
+
+	// Scalar Fallback and Remainder
+	for ( ; t < iCount; ++t )
+	{
+		fX = fSinPhi * pSinTheta[t];
+		fZ = fSinPhi * pCosTheta[t];
+		pX[t] = abs( fX ) < FLT_EPSILON ? 0.f : fX;
+		pZ[t] = abs( fZ ) < FLT_EPSILON ? 0.f : fZ;
+	}
+}
+
+// Builds the Sphere Grid from per-ring and per-meridian sine/cosine tables.  Both counts are
+//	rounded to integers once and every angle is computed from its index, so accumulated float
+//	error can't add a sliver Meridian or Ring at small slice sizes.  Slices that don't divide
+//	the sphere evenly are stretched to fit.
+static void generateGrid( float fSliceSize, SphereGrid* pGrid, bool bVectorized )
+{
+	vector<float> vPhiDegs, vSinPhi, vCosPhi;
+	vector<float> vThetaDegs, vSinTheta, vCosTheta;
+	float fPhi_Rads, fTheta_Rads, fY, fPhiStep;
+	unsigned int iRings, iMeridians, iOffset;
+
+	iMeridians = (unsigned int)lround( MAX_THETA_DEGS / fSliceSize );
+	iMeridians = iMeridians < 3 ? 3 : iMeridians;
+	iRings = (unsigned int)lround( MAX_PHI_DEGS / fSliceSize );
+	iRings = iRings < 2 ? 1 : iRings - 1;
+	fPhiStep = MAX_PHI_DEGS / (float)(iRings + 1);
+	pGrid->fThetaStep = MAX_THETA_DEGS / (float)iMeridians;
+
+	// Per-Ring Table
+	for ( unsigned int r = 1; r <= iRings; ++r )
+	{
+		float fPhi = (float)r * fPhiStep;
+
+		fPhi_Rads = fPhi * PI / 180.f;
+		vPhiDegs.push_back( fPhi );
+		vSinPhi.push_back( UNIT_RADIUS * sin( fPhi_Rads ) );
+		vCosPhi.push_back( UNIT_RADIUS * cos( fPhi_Rads ) );
+	}
+
+	// Per-Meridian Table
+	for ( unsigned int j = 0; j < iMeridians; ++j )
+	{
+		float fTheta = (float)j * pGrid->fThetaStep;
+
+		fTheta_Rads = fTheta * PI / 180.f;
+		vThetaDegs.push_back( fTheta );
+		vSinTheta.push_back( sin( fTheta_Rads ) );
+		vCosTheta.push_back( cos( fTheta_Rads ) );
+	}
+
+	pGrid->iRings = iRings;
+	pGrid->iMeridians = iMeridians;
+	pGrid->vX.resize( iRings * iMeridians );
+	pGrid->vY.resize( iRings * iMeridians );
+	pGrid->vZ.resize( iRings * iMeridians );
+	pGrid->vPhi.resize( iRings * iMeridians );
+	pGrid->vTheta.resize( iRings * iMeridians );
+
+	for ( unsigned int r = 0; r < iRings; ++r )
+	{
+		iOffset = r * iMeridians;
+		fY = abs( vCosPhi[r] ) < FLT_EPSILON ? 0.f : vCosPhi[r];
+
+		generateRing( vSinPhi[r], &vSinTheta[0], &vCosTheta[0], iMeridians, &pGrid->vX[iOffset], &pGrid->vZ[iOffset], bVectorized );
+		fill( pGrid->vY.begin() + iOffset, pGrid->vY.begin() + iOffset + iMeridians, fY );
+		fill( pGrid->vPhi.begin() + iOffset, pGrid->vPhi.begin() + iOffset + iMeridians, vPhiDegs[r] );
+		copy( vThetaDegs.begin(), vThetaDegs.end(), pGrid->vTheta.begin() + iOffset );
+	}
+}
+
+// Texture Coordinates from Spherical Coordinates in degrees:
+//	u wraps once around theta, v runs from the top pole (1) to the bottom pole (0).
+static inline void setUV( SphereVertex* pVert, float fPhi, float fTheta )
+{
+	pVert->fUV[0] = fTheta / MAX_THETA_DEGS;
+	pVert->fUV[1] = 1.f - (fPhi / MAX_PHI_DEGS);
+}
+
+// Writes one vertex of the triangle list: grid position k with the given spherical coordinates.
+static inline void emitVertex( SphereVertex*& pVert, const SphereGrid& pGrid, unsigned int k,
+							   float fPhi, float fTheta )
+{
+	pVert->fPosition[0] = pGrid.vX[k];
+	pVert->fPosition[1] = pGrid.vY[k];
+	pVert->fPosition[2] = pGrid.vZ[k];
+	setUV( pVert++, fPhi, fTheta );
+}
+
+// Writes a pole vertex of the triangle list with the given spherical coordinates.
+static inline void emitPole( SphereVertex*& pVert, float fY, float fPhi, float fTheta )
+{
+	pVert->fPosition[0] = 0.f;
+	pVert->fPosition[1] = fY;
+	pVert->fPosition[2] = 0.f;
+	setUV( pVert++, fPhi, fTheta );
+}
+
+// Deconstructs a Unit Sphere into approximated Triangles.
+void GenerateUVSphere( float fSliceSize, MyMesh* pMesh, bool bVectorized )
+{
+	SphereGrid pGrid;
+	unsigned int iThetaCuts, iGridSize, iBands, iTotalVerts;
+	float fThetaStep;
+	SphereVertex* pVert;
+
+	// Every loop bound and stride comes from the Grid's own counts.
+	generateGrid( fSliceSize, &pGrid, bVectorized );
+	iThetaCuts = pGrid.iMeridians;
+	iGridSize = pGrid.iRings * pGrid.iMeridians;
+	iBands = pGrid.iRings - 1;
+	fThetaStep = pGrid.fThetaStep;
+	iTotalVerts = (iThetaCuts * 3) + (iBands * iThetaCuts * 6) + (iThetaCuts * 3);
+
+	// Preallocate the whole Triangle List
+	pMesh->vVertices.resize( iTotalVerts );
+	pMesh->vPackedVertices.clear();
+	pVert = &pMesh->vVertices[0];
+
+	// Top Cap
+	for ( unsigned int i = 0; i < iThetaCuts; ++i )
+	{
+		unsigned int i_Nxt = (i + 1) % iThetaCuts;
+		bool bSeam = iThetaCuts - 1 == i;
+		emitVertex( pVert, pGrid, i, pGrid.vPhi[i], pGrid.vTheta[i] );
+		emitPole( pVert, UNIT_RADIUS, 0.f, bSeam ? pGrid.vTheta[i_Nxt] + 360.f : pGrid.vTheta[i_Nxt] );
+		emitVertex( pVert, pGrid, i_Nxt, pGrid.vPhi[i_Nxt], bSeam ? pGrid.vTheta[i] + fThetaStep : pGrid.vTheta[i_Nxt] );
+	}
+
+	// Middle Bands
+	for ( unsigned int i = 0; i < iGridSize - iThetaCuts; i += iThetaCuts )
+		for ( unsigned int p = 0; p < iThetaCuts; ++p )
+		{
+			// Forward Looking Variables
+			unsigned int p_Next = (p + 1) % iThetaCuts;
+			unsigned int i_Next = i + iThetaCuts;
+			bool bSeam = 0 == p_Next;
+
+			// Triangle 1: P1, P2, P3
+			emitVertex( pVert, pGrid, i + p, pGrid.vPhi[i + p], pGrid.vTheta[i + p] );
+			emitVertex( pVert, pGrid, i_Next + p_Next, pGrid.vPhi[i_Next + p_Next],
+						bSeam ? pGrid.vTheta[i_Next + p] + fThetaStep : pGrid.vTheta[i_Next + p_Next] );
+			emitVertex( pVert, pGrid, i_Next + p, pGrid.vPhi[i_Next + p], pGrid.vTheta[i_Next + p] );
+
+			// Triangle 2: P1, P2, P3
+			emitVertex( pVert, pGrid, i + p, pGrid.vPhi[i + p], pGrid.vTheta[i + p] );
+			emitVertex( pVert, pGrid, i + p_Next, pGrid.vPhi[i + p_Next],
+						bSeam ? pGrid.vTheta[i + p] + fThetaStep : pGrid.vTheta[i + p_Next] );
+			emitVertex( pVert, pGrid, i_Next + p_Next, pGrid.vPhi[i_Next + p_Next],
+						bSeam ? pGrid.vTheta[i_Next + p] + fThetaStep : pGrid.vTheta[i_Next + p_Next] );
+		}
+
+	// Bottom Cap
+	for ( unsigned int i = iGridSize - iThetaCuts; i < iGridSize; ++i )
+	{
+		unsigned int i_Nxt = (i + 1) >= iGridSize ? iGridSize - iThetaCuts : (i + 1);
+		bool bSeam = iGridSize - iThetaCuts == i_Nxt;
+		emitVertex( pVert, pGrid, i, pGrid.vPhi[i], pGrid.vTheta[i] );
+		emitVertex( pVert, pGrid, i_Nxt, pGrid.vPhi[i_Nxt], bSeam ? pGrid.vTheta[i_Nxt] + 360.0f : pGrid.vTheta[i_Nxt] );
+		emitPole( pVert, -UNIT_RADIUS, 180.f, bSeam ? pGrid.vTheta[i_Nxt] + 360.0f : pGrid.vTheta[i_Nxt] );
+	}
+
+	pMesh->iNumVerts = iTotalVerts;
+}
+
+// Quantizes a Unit Sphere into 16-bit normalized positions and texture coordinates.
+void PackSphereVertices( MyMesh* pMesh, bool bReleaseFloats )
+{
+	pMesh->vPackedVertices.resize( pMesh->vVertices.size() );
+
+	for ( unsigned int i = 0; i < pMesh->vVertices.size(); ++i )
+	{
+		const SphereVertex& pSrc = pMesh->vVertices[i];
+		PackedSphereVertex& pDst = pMesh->vPackedVertices[i];
+
+		for ( unsigned int c = 0; c < 3; ++c )
+			pDst.iPosition[c] = (GLshort)floor( pSrc.fPosition[c] * SNORM16_MAX + 0.5f );
+		pDst.iPosition[3] = 0;
+		pDst.iUV[0] = (GLushort)floor( pSrc.fUV[0] * UNORM16_MAX + 0.5f );
+		pDst.iUV[1] = (GLushort)floor( pSrc.fUV[1] * UNORM16_MAX + 0.5f );
+	}
+
+	if ( bReleaseFloats )
+		vector<SphereVertex>().swap( pMesh->vVertices );
+}
+
+// Deconstructs a Unit Sphere into an indexed Triangle List.  Each grid vertex is stored once;
+// only the seam column (where theta wraps back to 0) and the poles are duplicated for their UVs.
+void GenerateIndexedUVSphere( float fSliceSize, MyMesh* pMesh, bool bVectorized )
+{
+	SphereGrid pGrid;
+	unsigned int iRings, iMeridians, iRowSize, iFirstRing, iBottom;
+	SphereVertex* pVert;
+	GLuint* pIndex;
+
+	generateGrid( fSliceSize, &pGrid, bVectorized );
+	iRings = pGrid.iRings;
+	iMeridians = pGrid.iMeridians;
+	iRowSize = iMeridians + 1;						// Ring plus its seam duplicate
+	iFirstRing = iMeridians;						// Top Pole row comes first
+	iBottom = iFirstRing + (iRings * iRowSize);		// Bottom Pole row comes last
+
+	pMesh->iNumVerts = iBottom + iMeridians;
+	pMesh->vVertices.resize( pMesh->iNumVerts );
+	pMesh->vIndices.resize( ((iMeridians * 2) + ((iRings - 1) * iMeridians * 2)) * 3 );
+	pMesh->vPackedVertices.clear();
+	pVert = &pMesh->vVertices[0];
+	pIndex = &pMesh->vIndices[0];
+
+	// Top Pole: one per meridian, textured with the theta of the next meridian.
+	for ( unsigned int j = 0; j < iMeridians; ++j )
+		emitPole( pVert, UNIT_RADIUS, 0.f, j + 1 == iMeridians ? pGrid.vTheta[0] + 360.f : pGrid.vTheta[j + 1] );
+
+	// Rings
+	for ( unsigned int r = 0; r < iRings; ++r )
+	{
+		unsigned int iOffset = r * iMeridians;
+		for ( unsigned int j = 0; j < iMeridians; ++j )
+			emitVertex( pVert, pGrid, iOffset + j, pGrid.vPhi[iOffset + j], pGrid.vTheta[iOffset + j] );
+		emitVertex( pVert, pGrid, iOffset, pGrid.vPhi[iOffset], pGrid.vTheta[iOffset] + 360.f );	// Seam
+	}
+
+	// Bottom Pole
+	for ( unsigned int j = 0; j < iMeridians; ++j )
+		emitPole( pVert, -UNIT_RADIUS, 180.f, j + 1 == iMeridians ? pGrid.vTheta[0] + 360.f : pGrid.vTheta[j + 1] );
+
+	// Top Cap
+	for ( unsigned int j = 0; j < iMeridians; ++j )
+	{
+		*pIndex++ = iFirstRing + j;
+		*pIndex++ = j;
+		*pIndex++ = iFirstRing + j + 1;
+	}
+
+	// Middle Bands
+	for ( unsigned int r = 0; r + 1 < iRings; ++r )
+	{
+		GLuint iRow = iFirstRing + (r * iRowSize);
+		GLuint iNextRow = iRow + iRowSize;
+		for ( unsigned int j = 0; j < iMeridians; ++j )
+		{
+			// Triangle 1: P1, P2, P3
+			*pIndex++ = iRow + j;
+			*pIndex++ = iNextRow + j + 1;
+			*pIndex++ = iNextRow + j;
+
+			// Triangle 2: P1, P2, P3
+			*pIndex++ = iRow + j;
+			*pIndex++ = iRow + j + 1;
+			*pIndex++ = iNextRow + j + 1;
+		}
+	}
+
+	// Bottom Cap
+	for ( unsigned int j = 0; j < iMeridians; ++j )
+	{
+		GLuint iRow = iFirstRing + ((iRings - 1) * iRowSize);
+		*pIndex++ = iRow + j;
+		*pIndex++ = iRow + j + 1;
+		*pIndex++ = iBottom + j;
+	}
+}
+
+// Builds the final vertices of an arbitrary sphere from unit positions, assigning the same
+// UV mapping as the UV-Sphere.  Triangles straddling the theta seam get copies of their low-u
+// vertices at u + 1, and pole vertices get a copy per triangle at the triangle's average u.
+static void assignSphericalUVs( const vector<vec3>& vPositions, vector<GLuint>& vIndices, MyMesh* pMesh )
+{
+	map< GLuint, GLuint > pSeamCopies;
+	vector<bool> vIsPole( vPositions.size() );
+	float fU[3], fMinU, fMaxU, fPoleU;
+	unsigned int iNumPoles;
+
+	pMesh->vVertices.resize( vPositions.size() );
+	pMesh->vPackedVertices.clear();
+
+	for ( unsigned int i = 0; i < vPositions.size(); ++i )
+	{
+		const vec3& vPos = vPositions[i];
+		float fTheta = atan2( vPos.x, vPos.z ) * 180.f / PI;
+		float fPhi = acos( vPos.y < -1.f ? -1.f : (vPos.y > 1.f ? 1.f : vPos.y) ) * 180.f / PI;
+
+		fTheta = fTheta < 0.f ? fTheta + MAX_THETA_DEGS : fTheta;
+		vIsPole[i] = sqrt( vPos.x * vPos.x + vPos.z * vPos.z ) < POLE_EPSILON;
+		pMesh->vVertices[i].fPosition[0] = vPos.x;
+		pMesh->vVertices[i].fPosition[1] = vPos.y;
+		pMesh->vVertices[i].fPosition[2] = vPos.z;
+		setUV( &pMesh->vVertices[i], fPhi, fTheta );
+	}
+
+	for ( unsigned int t = 0; t < vIndices.size(); t += 3 )
+	{
+		fMinU = FLT_MAX;
+		fMaxU = -FLT_MAX;
+		for ( unsigned int c = 0; c < 3; ++c )
+		{
+			fU[c] = pMesh->vVertices[vIndices[t + c]].fUV[0];
+			if ( !vIsPole[vIndices[t + c]] )
+			{
+				fMinU = fU[c] < fMinU ? fU[c] : fMinU;
+				fMaxU = fU[c] > fMaxU ? fU[c] : fMaxU;
+			}
+		}
+
+		// Seam: wrap the low side of the triangle around to u + 1
+		if ( fMaxU - fMinU > 0.5f )
+			for ( unsigned int c = 0; c < 3; ++c )
+			{
+				GLuint iVert = vIndices[t + c];
+				if ( vIsPole[iVert] || fU[c] >= 0.5f )
+					continue;
+
+				map< GLuint, GLuint >::iterator iter = pSeamCopies.find( iVert );
+				if ( pSeamCopies.end() == iter )
+				{
+					SphereVertex pCopy = pMesh->vVertices[iVert];
+					pCopy.fUV[0] += 1.f;
+					pMesh->vVertices.push_back( pCopy );
+					vIsPole.push_back( false );
+					iter = pSeamCopies.insert( make_pair( iVert, (GLuint)pMesh->vVertices.size() - 1 ) ).first;
+				}
+				vIndices[t + c] = iter->second;
+				fU[c] += 1.f;
+			}
+
+		// Poles: give each triangle its own pole vertex centred between the other two
+		fPoleU = 0.f;
+		iNumPoles = 0;
+		for ( unsigned int c = 0; c < 3; ++c )
+			if ( vIsPole[vIndices[t + c]] )
+				++iNumPoles;
+			else
+				fPoleU += fU[c];
+
+		if ( iNumPoles > 0 && iNumPoles < 3 )
+		{
+			fPoleU /= (float)(3 - iNumPoles);
+			for ( unsigned int c = 0; c < 3; ++c )
+				if ( vIsPole[vIndices[t + c]] )
+				{
+					SphereVertex pCopy = pMesh->vVertices[vIndices[t + c]];
+					pCopy.fUV[0] = fPoleU;
+					pMesh->vVertices.push_back( pCopy );
+					vIsPole.push_back( true );
+					vIndices[t + c] = pMesh->vVertices.size() - 1;
+				}
+		}
+	}
+
+	pMesh->vIndices.swap( vIndices );
+	pMesh->iNumVerts = pMesh->vVertices.size();
+}
+
+// Index of the normalized midpoint between two vertices, shared between the two faces on that edge.
+static GLuint getMidpoint( GLuint iA, GLuint iB, vector<vec3>& vPositions, map< pair< GLuint, GLuint >, GLuint >& pMidpoints )
+{
+	pair< GLuint, GLuint > pEdge = iA < iB ? make_pair( iA, iB ) : make_pair( iB, iA );
+	map< pair< GLuint, GLuint >, GLuint >::iterator iter = pMidpoints.find( pEdge );
+	GLuint iReturn;
+
+	if ( pMidpoints.end() == iter )
+	{
+		vPositions.push_back( normalize( (vPositions[iA] + vPositions[iB]) * 0.5f ) );
+		iReturn = vPositions.size() - 1;
+		pMidpoints[pEdge] = iReturn;
+	}
+	else
+		iReturn = iter->second;
+
+	return iReturn;
+}
+
+// Subdivides an Icosahedron with a vertex at each pole and two staggered rings of 5 between them.
+void GenerateIcoSphere( unsigned int iSubdivisions, MyMesh* pMesh )
+{
+	vector<vec3> vPositions;
+	vector<GLuint> vIndices, vSplit;
+	map< pair< GLuint, GLuint >, GLuint > pMidpoints;
+	const GLuint iTop = 0, iBottom = 11;
+	float fTheta;
+
+	// Base Icosahedron: Top, Upper Ring (1-5), Lower Ring (6-10), Bottom
+	vPositions.push_back( vec3( 0.f, UNIT_RADIUS, 0.f ) );
+	for ( unsigned int k = 0; k < 10; ++k )
+	{
+		fTheta = ((float)k * 72.f + (k < 5 ? 0.f : 36.f)) * PI / 180.f;
+		vPositions.push_back( vec3( ICO_RING_RADIUS * sin( fTheta ),
+									k < 5 ? ICO_LATITUDE_Y : -ICO_LATITUDE_Y,
+									ICO_RING_RADIUS * cos( fTheta ) ) );
+	}
+	vPositions.push_back( vec3( 0.f, -UNIT_RADIUS, 0.f ) );
+
+	for ( GLuint k = 0; k < 5; ++k )
+	{
+		GLuint iUpper = 1 + k, iUpperNext = 1 + ((k + 1) % 5);
+		GLuint iLower = 6 + k, iLowerNext = 6 + ((k + 1) % 5);
+		GLuint pFaces[4][3] = { { iTop, iUpper, iUpperNext },
+								{ iUpper, iLower, iUpperNext },
+								{ iUpperNext, iLower, iLowerNext },
+								{ iLower, iBottom, iLowerNext } };
+		for ( unsigned int f = 0; f < 4; ++f )
+			vIndices.insert( vIndices.end(), pFaces[f], pFaces[f] + 3 );
+	}
+
+	// Split every face into 4 per subdivision
+	for ( unsigned int s = 0; s < iSubdivisions; ++s )
+	{
+		vSplit.clear();
+		vSplit.reserve( vIndices.size() * 4 );
+		for ( unsigned int t = 0; t < vIndices.size(); t += 3 )
+		{
+			GLuint iA = vIndices[t], iB = vIndices[t + 1], iC = vIndices[t + 2];
+			GLuint iAB = getMidpoint( iA, iB, vPositions, pMidpoints );
+			GLuint iBC = getMidpoint( iB, iC, vPositions, pMidpoints );
+			GLuint iCA = getMidpoint( iC, iA, vPositions, pMidpoints );
+			GLuint pFaces[12] = { iA, iAB, iCA,  iB, iBC, iAB,  iC, iCA, iBC,  iAB, iBC, iCA };
+			vSplit.insert( vSplit.end(), pFaces, pFaces + 12 );
+		}
+		vIndices.swap( vSplit );
+		pMidpoints.clear();
+	}
+
+	assignSphericalUVs( vPositions, vIndices, pMesh );
+}
+
+// Projects each face of a cube onto the Unit Sphere.  The mapping
+//	x' = x·sqrt( 1 - y²/2 - z²/2 + y²z²/3 ) (and likewise for y', z')
+// spreads the grid more evenly than plain normalization.
+// Odd division counts are rounded up: the +Y and -Y faces need a vertex at the pole, or their
+//	centre quad spans the U seam and smears the texture around it.
+void GenerateCubeSphere( unsigned int iFaceDivisions, MyMesh* pMesh )
+{
+	// Per Face: Normal, U Axis, V Axis with U x V = Normal so faces wind outward
+	const vec3 pFaces[6][3] = { { vec3(  1, 0, 0 ), vec3( 0, 0, -1 ), vec3( 0, 1, 0 ) },
+								{ vec3( -1, 0, 0 ), vec3( 0, 0,  1 ), vec3( 0, 1, 0 ) },
+								{ vec3( 0,  1, 0 ), vec3( 1, 0, 0 ), vec3( 0, 0, -1 ) },
+								{ vec3( 0, -1, 0 ), vec3( 1, 0, 0 ), vec3( 0, 0,  1 ) },
+								{ vec3( 0, 0,  1 ), vec3(  1, 0, 0 ), vec3( 0, 1, 0 ) },
+								{ vec3( 0, 0, -1 ), vec3( -1, 0, 0 ), vec3( 0, 1, 0 ) } };
+	unsigned int iRowSize;
+	vector<vec3> vPositions;
+	vector<GLuint> vIndices;
+	vec3 vCube, vSquared;
+
+	iFaceDivisions += iFaceDivisions & 1;
+	iRowSize = iFaceDivisions + 1;
+	vPositions.reserve( 6 * iRowSize * iRowSize );
+	vIndices.reserve( 6 * iFaceDivisions * iFaceDivisions * 6 );
+
+	for ( unsigned int f = 0; f < 6; ++f )
+	{
+		GLuint iFaceStart = vPositions.size();
+
+		for ( unsigned int j = 0; j <= iFaceDivisions; ++j )
+			for ( unsigned int i = 0; i <= iFaceDivisions; ++i )
+			{
+				vCube = pFaces[f][0] + pFaces[f][1] * ((2.f * i / iFaceDivisions) - 1.f)
+									 + pFaces[f][2] * ((2.f * j / iFaceDivisions) - 1.f);
+				vSquared = vCube * vCube;
+				vPositions.push_back( vec3( vCube.x * sqrt( 1.f - vSquared.y * 0.5f - vSquared.z * 0.5f + vSquared.y * vSquared.z / 3.f ),
+											vCube.y * sqrt( 1.f - vSquared.z * 0.5f - vSquared.x * 0.5f + vSquared.z * vSquared.x / 3.f ),
+											vCube.z * sqrt( 1.f - vSquared.x * 0.5f - vSquared.y * 0.5f + vSquared.x * vSquared.y / 3.f ) ) );
+			}
+
+		for ( unsigned int j = 0; j < iFaceDivisions; ++j )
+			for ( unsigned int i = 0; i < iFaceDivisions; ++i )
+			{
+				GLuint iCorner = iFaceStart + (j * iRowSize) + i;
+				GLuint pQuad[6] = { iCorner, iCorner + 1, iCorner + iRowSize + 1,
+									iCorner, iCorner + iRowSize + 1, iCorner + iRowSize };
+				vIndices.insert( vIndices.end(), pQuad, pQuad + 6 );
+			}
+	}
+
+	assignSphericalUVs( vPositions, vIndices, pMesh );
+}
+
+// Generates an indexed Unit Sphere of the requested topology.
+void GenerateSphere( eSphereTopology eTopology, float fDetail, MyMesh* pMesh )
+{
+	switch ( eTopology )
+	{
+		case ICO_SPHERE:
+			GenerateIcoSphere( (unsigned int)fDetail, pMesh );
+			break;
+		case CUBE_SPHERE:
+			GenerateCubeSphere( (unsigned int)fDetail, pMesh );
+			break;
+		default:
+			GenerateIndexedUVSphere( fDetail, pMesh );
+	}
+}
+
+// Score of a Vertex from its position in the simulated cache and its remaining valence.
+static float scoreVertex( int iCachePos, unsigned int iRemaining )
+{
+	float fScore = 0.f;
+
+	if ( 0 == iRemaining )
+		return -1.f;	// No triangles left to use this vertex
+
+	if ( iCachePos >= 0 )
+	{
+		if ( iCachePos < 3 )
+			fScore = LAST_TRI_SCORE;	// Used by the last triangle, don't reward it twice
+		else
+			fScore = pow( 1.f - (float)(iCachePos - 3) / (float)(VERTEX_CACHE_SIZE - 3), CACHE_DECAY_POWER );
+	}
+
+	// Favour vertices with few triangles left so they can be retired
+	fScore += VALENCE_BOOST_SCALE * pow( (float)iRemaining, -VALENCE_BOOST_POWER );
+
+	return fScore;
+}
+
+// Reorders the triangles of an indexed mesh for post-transform vertex cache reuse.
+void OptimizeVertexCache( vector<GLuint>& vIndices, unsigned int iNumVerts )
+{
+	unsigned int iNumTris = vIndices.size() / 3;
+	vector<unsigned int> vTriOffsets( iNumVerts + 1, 0 ), vVertTris( vIndices.size() );
+	vector<unsigned int> vRemaining( iNumVerts, 0 );
+	vector<int> vCachePos( iNumVerts, -1 );
+	vector<float> vVertScore( iNumVerts ), vTriScore( iNumTris );
+	vector<bool> vTriAdded( iNumTris, false );
+	vector<GLuint> vOutput;
+	vector<GLuint> vCache, vNewCache;
+	unsigned int iScanCursor = 0;
+	int iBestTri = -1;
+
+	if ( 0 == iNumTris )
+		return;
+
+	// Build Vertex -> Triangle adjacency
+	for ( unsigned int i = 0; i < vIndices.size(); ++i )
+		++vRemaining[vIndices[i]];
+	for ( unsigned int v = 0; v < iNumVerts; ++v )
+		vTriOffsets[v + 1] = vTriOffsets[v] + vRemaining[v];
+	{
+		vector<unsigned int> vFill( vTriOffsets.begin(), vTriOffsets.end() - 1 );
+		for ( unsigned int i = 0; i < vIndices.size(); ++i )
+			vVertTris[vFill[vIndices[i]]++] = i / 3;
+	}
+
+	// Initial Scores
+	for ( unsigned int v = 0; v < iNumVerts; ++v )
+		vVertScore[v] = scoreVertex( -1, vRemaining[v] );
+	for ( unsigned int t = 0; t < iNumTris; ++t )
+		vTriScore[t] = vVertScore[vIndices[t * 3]] + vVertScore[vIndices[t * 3 + 1]] + vVertScore[vIndices[t * 3 + 2]];
+
+	vOutput.reserve( vIndices.size() );
+	vCache.reserve( VERTEX_CACHE_SIZE + 3 );
+	vNewCache.reserve( VERTEX_CACHE_SIZE + 3 );
+
+	while ( vOutput.size() < vIndices.size() )
+	{
+		// Nothing scored from the cache, take the next unadded triangle.
+		if ( iBestTri < 0 )
+		{
+			while ( vTriAdded[iScanCursor] )
+				++iScanCursor;
+			iBestTri = iScanCursor;
+		}
+
+		// Emit the Triangle and push its vertices to the front of the cache
+		vTriAdded[iBestTri] = true;
+		vNewCache.clear();
+		for ( unsigned int c = 0; c < 3; ++c )
+		{
+			GLuint v = vIndices[iBestTri * 3 + c];
+			vOutput.push_back( v );
+			vNewCache.push_back( v );
+			--vRemaining[v];
+
+			// Remove the triangle from the vertex's active list
+			unsigned int* pBegin = &vVertTris[vTriOffsets[v]];
+			unsigned int* pEnd = pBegin + vRemaining[v] + 1;
+			*find( pBegin, pEnd, (unsigned int)iBestTri ) = *(pEnd - 1);
+		}
+		for ( unsigned int c = 0; c < vCache.size(); ++c )
+			if ( find( vNewCache.begin(), vNewCache.end(), vCache[c] ) == vNewCache.end() )
+				vNewCache.push_back( vCache[c] );
+
+		// Rescore everything that was in the cache, dropping what fell out
+		for ( unsigned int c = 0; c < vNewCache.size(); ++c )
+		{
+			GLuint v = vNewCache[c];
+			vCachePos[v] = c < VERTEX_CACHE_SIZE ? (int)c : -1;
+			float fDelta = scoreVertex( vCachePos[v], vRemaining[v] ) - vVertScore[v];
+			vVertScore[v] += fDelta;
+			for ( unsigned int t = vTriOffsets[v]; t < vTriOffsets[v] + vRemaining[v]; ++t )
+				vTriScore[vVertTris[t]] += fDelta;
+		}
+		if ( vNewCache.size() > VERTEX_CACHE_SIZE )
+			vNewCache.resize( VERTEX_CACHE_SIZE );
+		vCache.swap( vNewCache );
+
+		// Best Triangle touching the cache
+		float fBestScore = -1.f;
+		iBestTri = -1;
+		for ( unsigned int c = 0; c < vCache.size(); ++c )
+		{
+			GLuint v = vCache[c];
+			for ( unsigned int t = vTriOffsets[v]; t < vTriOffsets[v] + vRemaining[v]; ++t )
+				if ( vTriScore[vVertTris[t]] > fBestScore )
+				{
+					fBestScore = vTriScore[vVertTris[t]];
+					iBestTri = vVertTris[t];
+				}
+		}
+	}
+
+	vIndices.swap( vOutput );
+}
+
+// Average Cache Miss Ratio: vertex shader invocations per triangle with a FIFO cache of iCacheSize.
+// 3.0 is the worst case, 0.5 the best possible for a large regular mesh.
+float ComputeACMR( const vector<GLuint>& vIndices, unsigned int iNumVerts, unsigned int iCacheSize )
+{
+	vector<unsigned int> vInsertedAt( iNumVerts, 0 );	// Miss count when a vertex entered the cache, 0 = never
+	unsigned int iMisses = 0;
+
+	for ( unsigned int i = 0; i < vIndices.size(); ++i )
+	{
+		GLuint v = vIndices[i];
+		if ( 0 == vInsertedAt[v] || iMisses - vInsertedAt[v] >= iCacheSize )
+		{
+			++iMisses;
+			vInsertedAt[v] = iMisses;
+		}
+	}
+
+	return vIndices.empty() ? 0.f : (float)iMisses / (float)(vIndices.size() / 3);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "stdafx.h"
+
+// Definitions
+#define VERTEX_CACHE_SIZE	32		// Post-transform cache size targeted by OptimizeVertexCache()
+
+// Sphere Topologies
+enum eSphereTopology
+{
+	UV_SPHERE = 0,		// Latitude/Longitude slices, detail = slice size in degrees
+	ICO_SPHERE,			// Subdivided Icosahedron, detail = number of subdivisions
+	CUBE_SPHERE,		// Normalized Cube, detail = grid divisions per face edge
+	MAX_TOPOLOGIES
+};
+
+// Interleaved Vertex: Position on the Unit Sphere followed by its Texture Coordinate (20 bytes).
+struct SphereVertex
+{
+	GLfloat fPosition[3];
+	GLfloat fUV[2];
+};
+
+// Packed Vertex: 16-bit normalized Position (w is padding) and 16-bit normalized UV (12 bytes).
+struct PackedSphereVertex
+{
+	GLshort iPosition[4];
+	GLushort iUV[2];
+};
+
+// Mesh Structure
+// CPU-side Geometry for a Unit Sphere.  Built once and shared between all Planets
+//	that use the same tessellation, each Planet applies its own Radius as a scale.
+struct MyMesh
+{
+	vector<SphereVertex> vVertices;				// Triangle List
+	vector<PackedSphereVertex> vPackedVertices;	// Packed copy of vVertices, filled by PackSphereVertices()
+	vector<GLuint> vIndices;					// Triangle List indices, empty for a non-indexed mesh
+	int iNumVerts;
+
+	// initialize to an empty mesh
+	MyMesh() : iNumVerts( 0 )
+	{
+	}
+};
+
+// --------------------------------------------------------------------------
+// Generates a Unit UV-Sphere sliced every fSliceSize degrees along both phi and
+// theta into the given mesh.  Any previous contents of the mesh are replaced.
+// Rings are built from sine/cosine tables with SSE/AVX when available; pass
+// bVectorized = false to force the scalar path (identical output).
+
+void GenerateUVSphere( float fSliceSize, MyMesh* pMesh, bool bVectorized = true );
+
+// --------------------------------------------------------------------------
+// Indexed variant of GenerateUVSphere(): every vertex of the sphere is stored once
+// except along the theta seam and at the poles, where UVs need their own copy.
+
+void GenerateIndexedUVSphere( float fSliceSize, MyMesh* pMesh, bool bVectorized = true );
+
+// --------------------------------------------------------------------------
+// Indexed Unit Icosphere: an icosahedron with a vertex at each pole, each face
+// split into 4 iSubdivisions times.  Triangle areas stay near uniform.
+
+void GenerateIcoSphere( unsigned int iSubdivisions, MyMesh* pMesh );
+
+// --------------------------------------------------------------------------
+// Indexed Unit Cube-Sphere: each cube face is a grid of iFaceDivisions squared
+// quads projected to the sphere with an area-preserving mapping.
+
+void GenerateCubeSphere( unsigned int iFaceDivisions, MyMesh* pMesh );
+
+// --------------------------------------------------------------------------
+// Generates an indexed Unit Sphere of any topology.  fDetail is interpreted per
+// topology (see eSphereTopology).
+
+void GenerateSphere( eSphereTopology eTopology, float fDetail, MyMesh* pMesh );
+
+// --------------------------------------------------------------------------
+// Reorders the triangles in vIndices so consecutive triangles reuse vertices
+// still in a post-transform cache of VERTEX_CACHE_SIZE entries.
+
+void OptimizeVertexCache( vector<GLuint>& vIndices, unsigned int iNumVerts );
+
+// --------------------------------------------------------------------------
+// Average Cache Miss Ratio (vertex shader runs per triangle) of an index list
+// through a FIFO post-transform cache of iCacheSize entries.
+
+float ComputeACMR( const vector<GLuint>& vIndices, unsigned int iNumVerts, unsigned int iCacheSize );
+
+// --------------------------------------------------------------------------
+// Quantizes the mesh's vertices into vPackedVertices.  If bReleaseFloats is set
+// the full precision vertices are freed afterwards.
+
+void PackSphereVertices( MyMesh* pMesh, bool bReleaseFloats );
@@ -0,0 +1,124 @@
+#include "NullRenderDevice.h"
+
+// Names written by serialize(), by eRenderCommand.
+const char* c_sRenderCommandNames[MAX_RENDER_CMDS] = { "program", "texture", "mesh", "uniforms", "instances", "draw" };
+
+// Default Constructor, bRecord false only counts the calls.
+NullRenderDevice::NullRenderDevice( bool bRecord )
+{
+	m_bRecord = bRecord;
+	beginFrame();
+}
+
+// Destructor
+NullRenderDevice::~NullRenderDevice()
+{
+	// Nothing to Destruct
+}
+
+// Clears the last frame's Commands and counts, nothing is bound at the start of a frame.
+void NullRenderDevice::beginFrame()
+{
+	m_vCommands.clear();
+	memset( &m_pStats, 0, sizeof( m_pStats ) );
+	m_iBoundProgram = 0;
+	m_iBoundTexture = 0;
+	m_iBoundMesh = 0;
+	m_bTextureBound = m_bMeshBound = false;
+}
+
+// Everything is unbound, as the GL Device leaves it.
+void NullRenderDevice::endFrame()
+{
+	m_iBoundProgram = 0;
+	m_bTextureBound = m_bMeshBound = false;
+}
+
+/*******************************************************************\
+ * Recorded Calls												   *
+\*******************************************************************/
+
+void NullRenderDevice::bindProgram( GLuint iProgram )
+{
+	countBind( iProgram != m_iBoundProgram );
+	m_iBoundProgram = iProgram;
+	record( BIND_PROGRAM_CMD, iProgram );
+}
+
+void NullRenderDevice::bindTexture( GLuint iTexture )
+{
+	countBind( !m_bTextureBound || iTexture != m_iBoundTexture );
+	m_iBoundTexture = iTexture;
+	m_bTextureBound = true;
+	record( BIND_TEXTURE_CMD, iTexture );
+}
+
+void NullRenderDevice::bindMesh( unsigned int iMesh )
+{
+	countBind( !m_bMeshBound || iMesh != m_iBoundMesh );
+	m_iBoundMesh = iMesh;
+	m_bMeshBound = true;
+	record( BIND_MESH_CMD, iMesh );
+}
+
+// Counted as the bytes requested: both matrices and the Lighting flag.  The GL Device's Uniform
+//	cache may skip repeated values, so less can reach GL.
+void NullRenderDevice::setDrawUniforms( const DrawUniforms& pUniforms )
+{
+	m_pStats.iBytesRequested += 2 * sizeof( mat4 ) + sizeof( GLint );
+	record( SET_UNIFORMS_CMD, pUniforms.bLight );
+}
+
+void NullRenderDevice::uploadInstances( const vector<BodyInstance>& vInstances )
+{
+	m_pStats.iBytesRequested += vInstances.size() * sizeof( BodyInstance );
+	record( UPLOAD_INSTANCES_CMD, vInstances.size() );
+}
+
+// Drawing without a Program or Mesh bound is a bug in the caller, reported like GL errors are.
+void NullRenderDevice::drawMesh( unsigned int iMesh, unsigned int iFirstInstance, unsigned int iNumInstances )
+{
+	if ( 0 == m_iBoundProgram || !m_bMeshBound || iMesh != m_iBoundMesh )
+		cout << "Error: Mesh " << iMesh << " drawn without it and a Program bound." << endl;
+
+	m_pStats.iNumInstancesDrawn += 0 == iNumInstances ? 1 : iNumInstances;
+	record( DRAW_CMD, iMesh, iFirstInstance, iNumInstances );
+}
+
+/*******************************************************************\
+ * Results														   *
+\*******************************************************************/
+
+// Writes the recorded frame, one Command per line: its name, then its arguments.
+void NullRenderDevice::serialize( ostream& pOut ) const
+{
+	for ( unsigned int i = 0; i < m_vCommands.size(); ++i )
+	{
+		const RenderCommand& pCommand = m_vCommands[i];
+
+		pOut << c_sRenderCommandNames[pCommand.eType];
+		for ( unsigned int a = 0; a < 3; ++a )
+			pOut << " " << pCommand.iArgs[a];
+		pOut << "\n";
+	}
+}
+
+// Counts the Command and keeps it if recording.
+void NullRenderDevice::record( eRenderCommand eType, unsigned int iArg0, unsigned int iArg1, unsigned int iArg2 )
+{
+	++m_pStats.iNumCommands[eType];
+
+	if ( m_bRecord )
+	{
+		RenderCommand pCommand = { eType, { iArg0, iArg1, iArg2 } };
+		m_vCommands.push_back( pCommand );
+	}
+}
+
+void NullRenderDevice::countBind( bool bChanged )
+{
+	if ( bChanged )
+		++m_pStats.iStateChanges;
+	else
+		++m_pStats.iRedundantBinds;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+/* INCLUDES */
+#include "stdafx.h"
+#include "RenderDevice.h"
+
+// Commands a NullRenderDevice records
+enum eRenderCommand
+{
+	BIND_PROGRAM_CMD = 0,
+	BIND_TEXTURE_CMD,
+	BIND_MESH_CMD,
+	SET_UNIFORMS_CMD,
+	UPLOAD_INSTANCES_CMD,
+	DRAW_CMD,
+	MAX_RENDER_CMDS
+};
+
+// One recorded call and its arguments, unused arguments are 0.
+struct RenderCommand
+{
+	eRenderCommand eType;
+	unsigned int iArgs[3];
+};
+
+// Counts for the current frame.  State changes are binds that changed what was bound; redundant
+//	binds re-bound what already was.
+struct NullDeviceStats
+{
+	unsigned int iNumCommands[MAX_RENDER_CMDS];
+	unsigned int iStateChanges, iRedundantBinds;
+	unsigned int iNumInstancesDrawn;
+	unsigned long long iBytesRequested;		// Instances and per-draw Uniforms, before any Uniform caching
+};
+
+// Class: NullRenderDevice
+// Purpose: Render Device that records every call instead of drawing.  Needs no GL Context, so
+//			the submission path can be regression-tested and profiled headless.
+class NullRenderDevice : public RenderDevice
+{
+public:
+	NullRenderDevice( bool bRecord = true );
+	~NullRenderDevice();
+
+	void beginFrame();
+	void endFrame();
+
+	void bindProgram( GLuint iProgram );
+	void bindTexture( GLuint iTexture );
+	void bindMesh( unsigned int iMesh );
+	void setDrawUniforms( const DrawUniforms& pUniforms );
+
+	void uploadInstances( const vector<BodyInstance>& vInstances );
+	void drawMesh( unsigned int iMesh, unsigned int iFirstInstance, unsigned int iNumInstances );
+
+	// Results of the frame since beginFrame().  Commands are only kept while recording, the
+	//	counts are always kept.
+	const NullDeviceStats& getStats() const { return m_pStats; }
+	const vector< RenderCommand >& getCommands() const { return m_vCommands; }
+	void serialize( ostream& pOut ) const;
+
+private:
+	bool m_bRecord;
+	vector< RenderCommand > m_vCommands;
+	NullDeviceStats m_pStats;
+
+	// Bound State, reset every frame
+	GLuint m_iBoundProgram, m_iBoundTexture;
+	unsigned int m_iBoundMesh;
+	bool m_bTextureBound, m_bMeshBound;
+
+	void record( eRenderCommand eType, unsigned int iArg0, unsigned int iArg1 = 0, unsigned int iArg2 = 0 );
+	void countBind( bool bChanged );
+};
@@ -0,0 +1,184 @@
+#include "OrbitSystem.h"
+#include "ThreadPool.h"
+
+// Constructor
+OrbitSystem::OrbitSystem()
+{
+}
+
+// Destructor
+OrbitSystem::~OrbitSystem()
+{
+}
+
+/************************************************************************\
+ * Orbit Management                                                     *
+\************************************************************************/
+
+// Adds an orbit taking dPeriod time units per revolution, returns its index.
+unsigned int OrbitSystem::addOrbit( const OrbitalElements& pElements, double dPeriod )
+{
+	unsigned int iOrbit = m_vSemiMajor.size();
+
+	m_vSemiMajor.push_back( 0.f );
+	m_vSemiMinor.push_back( 0.f );
+	m_vEccentricity.push_back( 0.f );
+	m_vMeanAnomaly.push_back( 0.0 );
+	m_vMeanMotion.push_back( 0.0 );
+	m_vPx.push_back( 0.f );	m_vPy.push_back( 0.f );	m_vPz.push_back( 0.f );
+	m_vQx.push_back( 0.f );	m_vQy.push_back( 0.f );	m_vQz.push_back( 0.f );
+	m_vX.push_back( 0.f );	m_vY.push_back( 0.f );	m_vZ.push_back( 0.f );
+
+	setOrbit( iOrbit, pElements, dPeriod );
+
+	return iOrbit;
+}
+
+// Replaces the elements of an existing orbit.  The position is refreshed for time 0 until the
+//	next evaluate().
+void OrbitSystem::setOrbit( unsigned int iOrbit, const OrbitalElements& pElements, double dPeriod )
+{
+	vec3 vP, vQ;
+
+	ComputeBasis( pElements, &vP, &vQ );
+
+	m_vSemiMajor[iOrbit] = pElements.fSemiMajorAxis;
+	m_vSemiMinor[iOrbit] = pElements.fSemiMajorAxis * sqrt( 1.f - pElements.fEccentricity * pElements.fEccentricity );
+	m_vEccentricity[iOrbit] = pElements.fEccentricity;
+	m_vMeanAnomaly[iOrbit] = pElements.fMeanAnomaly;
+	m_vMeanMotion[iOrbit] = 0.0 == dPeriod ? 0.0 : TWO_PI / dPeriod;
+	m_vPx[iOrbit] = vP.x;	m_vPy[iOrbit] = vP.y;	m_vPz[iOrbit] = vP.z;
+	m_vQx[iOrbit] = vQ.x;	m_vQy[iOrbit] = vQ.y;	m_vQz[iOrbit] = vQ.z;
+
+	evaluateRange( 0.0, iOrbit, iOrbit + 1 );
+}
+
+// Makes sure iNumOrbits can be held without allocating.
+void OrbitSystem::reserve( unsigned int iNumOrbits )
+{
+	m_vSemiMajor.reserve( iNumOrbits );
+	m_vSemiMinor.reserve( iNumOrbits );
+	m_vEccentricity.reserve( iNumOrbits );
+	m_vMeanAnomaly.reserve( iNumOrbits );
+	m_vMeanMotion.reserve( iNumOrbits );
+	m_vPx.reserve( iNumOrbits );	m_vPy.reserve( iNumOrbits );	m_vPz.reserve( iNumOrbits );
+	m_vQx.reserve( iNumOrbits );	m_vQy.reserve( iNumOrbits );	m_vQz.reserve( iNumOrbits );
+	m_vX.reserve( iNumOrbits );		m_vY.reserve( iNumOrbits );		m_vZ.reserve( iNumOrbits );
+}
+
+// Removes every orbit.
+void OrbitSystem::clear()
+{
+	m_vSemiMajor.clear();
+	m_vSemiMinor.clear();
+	m_vEccentricity.clear();
+	m_vMeanAnomaly.clear();
+	m_vMeanMotion.clear();
+	m_vPx.clear();	m_vPy.clear();	m_vPz.clear();
+	m_vQx.clear();	m_vQy.clear();	m_vQz.clear();
+	m_vX.clear();	m_vY.clear();	m_vZ.clear();
+}
+
+/************************************************************************\
+ * Evaluation                                                           *
+\************************************************************************/
+
+// Evaluates every orbit at dTime, split across the pool when there are enough of them.
+void OrbitSystem::evaluate( double dTime, ThreadPool* pPool )
+{
+	unsigned int iNumOrbits = getNumOrbits();
+
+	if ( NULL == pPool || iNumOrbits < 2 * ORBITS_PER_JOB )
+		evaluateRange( dTime, 0, iNumOrbits );
+	else
+		pPool->parallelFor( iNumOrbits, ORBITS_PER_JOB, [this, dTime]( unsigned int iBegin, unsigned int iEnd ) { evaluateRange( dTime, iBegin, iEnd ); } );
+}
+
+// Evaluates orbits [iBegin, iEnd) at dTime.  Every orbit runs the same fixed number of Newton
+//	steps, so the loop has no data-dependent branches and the result doesn't depend on how the
+//	range was split.
+void OrbitSystem::evaluateRange( double dTime, unsigned int iBegin, unsigned int iEnd )
+{
+	for ( unsigned int i = iBegin; i < iEnd; ++i )
+	{
+		// Mean Anomaly wrapped in double precision, the rest is done in float.
+		double dMeanAnomaly = fmod( m_vMeanAnomaly[i] + m_vMeanMotion[i] * dTime, TWO_PI );
+		float fMeanAnomaly = (float)dMeanAnomaly;
+		float fEccentricity = m_vEccentricity[i];
+
+		// Solve Kepler's Equation E - e sin E = M for the Eccentric Anomaly
+		float fEccAnomaly = fMeanAnomaly + fEccentricity * sin( fMeanAnomaly );
+		for ( unsigned int k = 0; k < KEPLER_ITERATIONS; ++k )
+			fEccAnomaly -= (fEccAnomaly - fEccentricity * sin( fEccAnomaly ) - fMeanAnomaly) / (1.f - fEccentricity * cos( fEccAnomaly ));
+
+		// Position within the orbit plane, then into the parent's frame
+		float fP = m_vSemiMajor[i] * (cos( fEccAnomaly ) - fEccentricity);
+		float fQ = m_vSemiMinor[i] * sin( fEccAnomaly );
+
+		m_vX[i] = fP * m_vPx[i] + fQ * m_vQx[i];
+		m_vY[i] = fP * m_vPy[i] + fQ * m_vQy[i];
+		m_vZ[i] = fP * m_vPz[i] + fQ * m_vQz[i];
+	}
+}
+
+/************************************************************************\
+ * Helpers                                                              *
+\************************************************************************/
+
+// The orbit's highest point sits 90 degrees past the Ascending Node, so an Argument of
+//	Periapsis of 90 degrees puts vPosition at periapsis (time 0) and the Inclination lifts it
+//	to its height.  The Ascending Node turns it to face vPosition's horizontal direction.
+OrbitalElements OrbitSystem::CircularOrbitThrough( const vec3& vPosition )
+{
+	OrbitalElements pReturn;
+	float fRadius = length( vPosition );
+
+	pReturn.fSemiMajorAxis = fRadius;
+	pReturn.fInclination = 0.f == fRadius ? 0.f : asin( vPosition.y / fRadius );
+	pReturn.fAscendingNode = atan2( -vPosition.x, -vPosition.z );
+	pReturn.fArgPeriapsis = (float)(TWO_PI / 4.0);
+
+	return pReturn;
+}
+
+// Perifocal basis: rotate by the Argument of Periapsis within the plane, tilt the plane by the
+//	Inclination about the line of nodes (+X), then turn the line of nodes about +Y.
+//	P = RotY( Node ) * RotX( Incl ) * RotY( ArgPeri ) * ( 1, 0, 0 )
+//	Q = RotY( Node ) * RotX( Incl ) * RotY( ArgPeri ) * ( 0, 0, -1 )
+void OrbitSystem::ComputeBasis( const OrbitalElements& pElements, vec3* pP, vec3* pQ )
+{
+	double dCosW = cos( (double)pElements.fArgPeriapsis ), dSinW = sin( (double)pElements.fArgPeriapsis );
+	double dCosI = cos( (double)pElements.fInclination ), dSinI = sin( (double)pElements.fInclination );
+	double dCosN = cos( (double)pElements.fAscendingNode ), dSinN = sin( (double)pElements.fAscendingNode );
+
+	// RotY( ArgPeri ) then RotX( Incl ): P starts at ( cosW, 0, -sinW ), Q at ( -sinW, 0, -cosW )
+	double dPy = dSinW * dSinI, dPz = -dSinW * dCosI;
+	double dQy = dCosW * dSinI, dQz = -dCosW * dCosI;
+
+	// RotY( Node )
+	*pP = vec3( dCosW * dCosN + dPz * dSinN, dPy, -dCosW * dSinN + dPz * dCosN );
+	*pQ = vec3( -dSinW * dCosN + dQz * dSinN, dQy, dSinW * dSinN + dQz * dCosN );
+}
+
+// Evaluates a single orbit in double precision, used as the reference for evaluate().
+vec3 OrbitSystem::ComputePosition( const OrbitalElements& pElements, double dPeriod, double dTime )
+{
+	double dEccentricity = pElements.fEccentricity;
+	double dMeanAnomaly = pElements.fMeanAnomaly + (0.0 == dPeriod ? 0.0 : TWO_PI / dPeriod * dTime);
+	double dEccAnomaly, dStep = 1.0;
+	vec3 vP, vQ;
+
+	// Newton iterations until converged
+	dMeanAnomaly = fmod( dMeanAnomaly, TWO_PI );
+	dEccAnomaly = dMeanAnomaly + dEccentricity * sin( dMeanAnomaly );
+	for ( unsigned int k = 0; k < 64 && fabs( dStep ) > 1e-12; ++k )
+	{
+		dStep = (dEccAnomaly - dEccentricity * sin( dEccAnomaly ) - dMeanAnomaly) / (1.0 - dEccentricity * cos( dEccAnomaly ));
+		dEccAnomaly -= dStep;
+	}
+
+	ComputeBasis( pElements, &vP, &vQ );
+
+	return vP * (float)(pElements.fSemiMajorAxis * (cos( dEccAnomaly ) - dEccentricity))
+		 + vQ * (float)(pElements.fSemiMajorAxis * sqrt( 1.0 - dEccentricity * dEccentricity ) * sin( dEccAnomaly ));
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "stdafx.h"
+
+// Forward Declarations
+class ThreadPool;
+
+// Definitions
+#define INVALID_ORBIT		0xFFFFFFFF
+#define KEPLER_ITERATIONS	6		// Newton steps solving Kepler's Equation, enough below MAX_ECCENTRICITY
+#define MAX_ECCENTRICITY	0.9f
+#define ORBITS_PER_JOB		8192	// Smaller orbit counts are evaluated on the calling thread
+#define TWO_PI				6.283185307179586
+
+// Keplerian Orbital Elements, relative to the parent body.  The reference plane is XZ with +Y up,
+//	angles are in radians.  A body orbits from +X towards -Z, as a positive rotation about +Y does.
+struct OrbitalElements
+{
+	float fSemiMajorAxis;
+	float fEccentricity;
+	float fInclination;		// Tilt of the orbit plane about the line of nodes
+	float fAscendingNode;	// Longitude of the Ascending Node, about +Y from +X
+	float fArgPeriapsis;	// Angle from the Ascending Node to periapsis, within the orbit plane
+	float fMeanAnomaly;		// At time 0
+
+	// initialize to a unit circle
+	OrbitalElements() : fSemiMajorAxis( 1.f ), fEccentricity( 0.f ), fInclination( 0.f ), fAscendingNode( 0.f ), fArgPeriapsis( 0.f ), fMeanAnomaly( 0.f )
+	{
+	}
+};
+
+// Class: OrbitSystem
+// Purpose: Evaluates every orbit's position as a pure function of simulation time, so any time
+//			can be jumped to directly and replays are exact.  Elements are stored as parallel
+//			arrays with the orientation pre-folded into a perifocal basis (P towards periapsis,
+//			Q along the motion there), so evaluation is a Kepler solve and two scaled vectors.
+class OrbitSystem
+{
+public:
+	OrbitSystem();
+	~OrbitSystem();
+
+	// Orbit Management
+	unsigned int addOrbit( const OrbitalElements& pElements, double dPeriod );
+	void setOrbit( unsigned int iOrbit, const OrbitalElements& pElements, double dPeriod );
+	void reserve( unsigned int iNumOrbits );
+	void clear();
+	unsigned int getNumOrbits() const { return m_vSemiMajor.size(); }
+	double getPeriod( unsigned int iOrbit ) const { return TWO_PI / m_vMeanMotion[iOrbit]; }
+
+	// Evaluation
+	// Positions for dTime are written to the position arrays, read back with getPosition().
+	void evaluate( double dTime, ThreadPool* pPool );
+	void evaluateRange( double dTime, unsigned int iBegin, unsigned int iEnd );
+	vec3 getPosition( unsigned int iOrbit ) const { return vec3( m_vX[iOrbit], m_vY[iOrbit], m_vZ[iOrbit] ); }
+
+	// Circular orbit of radius |vPosition| whose highest point (+Y) is vPosition at time 0.
+	static OrbitalElements CircularOrbitThrough( const vec3& vPosition );
+
+	// Single orbit evaluation without the arrays, for reference and one-off queries.
+	static vec3 ComputePosition( const OrbitalElements& pElements, double dPeriod, double dTime );
+
+private:
+	OrbitSystem( const OrbitSystem& pCopy );	// Don't allow use of Copy Constructor
+
+	static void ComputeBasis( const OrbitalElements& pElements, vec3* pP, vec3* pQ );
+
+	// Per Orbit
+	vector<float> m_vSemiMajor, m_vSemiMinor, m_vEccentricity;
+	vector<double> m_vMeanAnomaly, m_vMeanMotion;		// Double so large times stay precise
+	vector<float> m_vPx, m_vPy, m_vPz;					// Perifocal basis, P
+	vector<float> m_vQx, m_vQy, m_vQz;					// Perifocal basis, Q
+	vector<float> m_vX, m_vY, m_vZ;						// Positions at the last evaluated time
+};
@@ -3,105 +3,157 @@
 #include "ShaderManager.h"
 #include "ImageReader.h"
 #include "Transformation.h"
+#include "Camera.h"
+#include "OrbitSystem.h"
+#include "RenderQueue.h"
 
-#define PI 3.14159265f
-#define SLICE_SIZE 10.f
-#define MAX_THETA_DEGS 360.f
-#define MAX_PHI_DEGS 180.f
-#define MAX_THETA_CUTS (int)(MAX_THETA_DEGS / SLICE_SIZE)
-#define MAX_PHI_CUTS (int)(MAX_PHI_DEGS / SLICE_SIZE)
-#define FRAMES_PER_SECOND 40.f
-#define FF_SPEED 50.f
+#define LOD_HYSTERESIS 0.15f
 
 #define X 0
 #define Y 1
 #define Z 2
 
+// Minimum projected radius (in pixels) for each LOD to be chosen, finest first.
+const float c_fLODPixelThresholds[NUM_SPHERE_LODS] = { 200.f, 80.f, 30.f, 10.f, 0.f };
+
 // Default Constructor.
 Planet::Planet( float fRadius, 
-				const string& sTextureName, 
-				Transformation* pTransform,
+				const MyTexture* pTexture, 
+				SceneGraph* pSceneGraph,
+				TransformHandle hTransform,
 				float fAxialTilt, 
 				float fSecsForRotation, 
-				float fSecsForOrbit,
-				bool bLightPlanet )
+				unsigned int iOrbit,
+				bool bLightPlanet,
+				eSphereTopology eTopology )
 {
-	// Bind Texture to this Planet.
-	InitializeTexture( &m_pTexture, sTextureName );
-
 	// Init Position (World Coordinates)
 	m_vPos = vec3( 0, 0, 0 );
 
-	// Texture Information for Geometry in shaders
-	m_pTextCoords[0][X] = 0;
-	m_pTextCoords[0][Y] = 0;
-	m_pTextCoords[1][X] = 0;
-	m_pTextCoords[1][Y] = m_pTexture.height;
-	m_pTextCoords[2][X] = m_pTexture.width;
-	m_pTextCoords[2][Y] = m_pTexture.height;
-	m_pTextCoords[3][X] = m_pTexture.width;
-	m_pTextCoords[3][Y] = 0;
-
-	m_bUpdated = true;
-	m_bAnimate = true;
-	m_bFastForward = false;
+	m_iOrbit = iOrbit;
 	m_bLightPlanet = bLightPlanet;
 	m_fRadius = fRadius;
 	m_fCurrRotation = 0.f;
+	m_fPrevRotation = 0.f;
+	m_vPrevWorldPos = vec3( 0.f );
 
 	// degrees devided by seconds per rotation = degrees per second
-	m_fOrbitPerFrame = (0 == fSecsForOrbit) ? 0.f :  360.f / fSecsForOrbit;
 	m_fRotPerFrame = (0 == fSecsForRotation) ? 0.f : 360.f / fSecsForRotation;
-	m_pLastTick = clock();
 
-	m_pTransform = pTransform;
+	m_pTexture = pTexture;
+	m_pSceneGraph = pSceneGraph;
+	m_hTransform = hTransform;
+	m_eTopology = eTopology;
+	m_iLODLevel = NUM_SPHERE_LODS - 1;
+
+	// Develop Axial Tilt Rotation
+	m_qAxialTilt = angleAxis( fAxialTilt, vec3( 0, 0, 1 ) );
+}
+
+// Fetches the shared Unit Sphere LOD chain.  The Planet's Texture must
+//	already be uploaded; this is the part that requires the GL Context.
+bool Planet::initializeGL()
+{
+	bool bReturn = 0 != m_pTexture->textureName;
+
+	// Texture Information for Geometry in shaders
+	m_pTextCoords[0][X] = 0;
+	m_pTextCoords[0][Y] = 0;
+	m_pTextCoords[1][X] = 0;
+	m_pTextCoords[1][Y] = m_pTexture->height;
+	m_pTextCoords[2][X] = m_pTexture->width;
+	m_pTextCoords[2][Y] = m_pTexture->height;
+	m_pTextCoords[3][X] = m_pTexture->width;
+	m_pTextCoords[3][Y] = 0;
 
-	// Develop UV coordinates for Planet
-	constructUVCoords();
+	// Fetch the shared Unit Sphere LOD chain for this Planet
+	GeometryManager::getInstance()->getSphereLODChain( m_eTopology, m_iMeshLODs );
 
-	// Develop Axial Tilt Matrix
-	m_AxialTilt = rotate( mat4( 1.f ), fAxialTilt, vec3( 0, 0, 1 ) );
-	m_pTransform->updateRotation( m_AxialTilt );
+	return bReturn;
 }
 
 // Destructor
 Planet::~Planet()
 {
-	m_pTransform = NULL;
+	m_pTexture = NULL;
+	m_pSceneGraph = NULL;
+}
+
+// Records a draw of the Planet with the TEXTURE Program, its Uniforms are set when it's submitted.
+void Planet::queueDraw( RenderQueue* pQueue, float fAlpha, const vec3& vCameraPos )
+{
+	DrawUniforms pUniforms;
+	DrawPacket pPacket;
+	vec3 vWorldPos = getWorldPosition( fAlpha );
+
+	// Only the position is interpolated, the orientation of the parent frame is at most a step old.
+	pUniforms.mToWorld = getWorldMatrix();
+	pUniforms.mToWorld[3] = vec4( vWorldPos, 1.f );
+	pUniforms.mLocalTransform = getLocalTransform( fAlpha );
+	pUniforms.bLight = m_bLightPlanet;
+
+	pPacket.iProgram = ShaderManager::getInstance()->getProgram( TEXTURE );
+	pPacket.iTexture = m_pTexture->textureName;
+	pPacket.iMesh = m_iMeshLODs[m_iLODLevel];
+	pPacket.iFirstInstance = 0;
+	pPacket.iNumInstances = 0;
+	pPacket.iUniforms = pQueue->pushUniforms( pUniforms );
+	pPacket.iKey = RenderQueue::makeKey( OPAQUE_LAYER, pPacket.iProgram, pPacket.iTexture, pPacket.iMesh,
+										 length( vWorldPos - vCameraPos ) );
+	pQueue->push( pPacket );
+}
+
+// Picks the LOD for this frame from the Planet's projected Radius on screen.
+// Changing level requires passing the threshold by LOD_HYSTERESIS to prevent popping.
+void Planet::selectLOD( Camera* pCamera, float fAlpha )
+{
+	float fPixelRadius = pCamera->getProjectedRadius( getWorldPosition( fAlpha ), m_fRadius );
+	unsigned int iTarget = 0;
+
+	// Find the finest level the projected size qualifies for
+	while ( iTarget < NUM_SPHERE_LODS - 1 && fPixelRadius < c_fLODPixelThresholds[iTarget] )
+		++iTarget;
+
+	if ( iTarget < m_iLODLevel )
+	{
+		// Refine to the finest level whose threshold is passed by the margin
+		for ( unsigned int l = iTarget; l < m_iLODLevel; ++l )
+		{
+			if ( fPixelRadius >= c_fLODPixelThresholds[l] * (1.f + LOD_HYSTERESIS) )
+			{
+				m_iLODLevel = l;
+				break;
+			}
+		}
+	}
+	else if ( iTarget > m_iLODLevel && fPixelRadius < c_fLODPixelThresholds[m_iLODLevel] * (1.f - LOD_HYSTERESIS) )
+		m_iLODLevel = iTarget;	// Coarsen
+}
+
+// Fills the Instance the Instanced Shader draws this Planet from.  The Axial Tilt is folded into
+//	the World Matrix so only the Spin and Radius remain to be applied per Vertex.
+void Planet::getInstanceData( float fAlpha, BodyInstance* pInstance )
+{
+	mat4 mToWorld = getWorldMatrix();
+
+	mToWorld[3] = vec4( getWorldPosition( fAlpha ), 1.f );
+	mToWorld = mToWorld * mat4_cast( m_qAxialTilt );
+
+	memcpy( pInstance->fToWorld, value_ptr( mToWorld ), sizeof( pInstance->fToWorld ) );
+	pInstance->fSpin = radians( getSpin( fAlpha ) );
+	pInstance->fRadius = m_fRadius;
+	pInstance->fLit = m_bLightPlanet ? 1.f : 0.f;
+	pInstance->fPadding = 0.f;
 }
 
-// Deconstructs the Planet into approximated Triangles and sets up OpenGL to render the Triangles.
-void Planet::renderPlanet()
+// Sphere around the Planet at the start and end of the step, so it stays valid for any
+//	interpolation factor until the next step.
+void Planet::getBoundingSphere( vec3* pCenter, float* pRadius )
 {
-	GeometryManager* m_pGmtryMngr = GeometryManager::getInstance();
-	ShaderManager* m_pShdrMngr = ShaderManager::getInstance();
-	const MyGeometry* pGeometry = m_pGmtryMngr->getGeometry();
-
-	// Update Planet Rotations
-	updatePlanet();
-
-	// Bind Planet's Texture Data for Drawing this Planet.
-	m_pGmtryMngr->bindTextureData( sizeof( m_pTextCoords ), &m_pTextCoords );
-	setLocalTransform( m_pShdrMngr );
-	m_pShdrMngr->setWorldMatrix( m_pTransform->getTransformationMatrix( true ) );
-	m_pShdrMngr->setLightBool( m_bLightPlanet );
-
-	// bind our shader program and the vertex array object containing our
-	// scene geometry, then tell OpenGL to draw our geometry
-	glUseProgram( m_pShdrMngr->getProgram( TEXTURE ) );
-	glBindVertexArray( pGeometry->vertexArray );
-
-	// Set Vertices for Drawing
-	glBindBuffer( GL_ARRAY_BUFFER, pGeometry->vertexBuffer );
-	glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( float )*m_vVertices.size(), &m_vVertices[0] );
-	glBindBuffer( GL_ARRAY_BUFFER, pGeometry->colourBuffer );
-	glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( float )*m_vColors.size(), &m_vColors[0] );
-	glBindTexture( GL_TEXTURE_2D, m_pTexture.textureName );
-
-	glDrawArrays( GL_TRIANGLES, 0, m_iNumTris );
-
-	glBindVertexArray( 0 );
-	glUseProgram( 0 );
+	vec3 vCurrWorldPos = vec3( getWorldMatrix()[3] );
+
+	*pCenter = (m_vPrevWorldPos + vCurrWorldPos) * 0.5f;
+	*pRadius = m_fRadius + length( vCurrWorldPos - m_vPrevWorldPos ) * 0.5f;
 }
 
 // Binds the texture to the geometry
@@ -115,179 +167,58 @@ void Planet::getTextureData( GLsizeiptr* iPtr, void** data )
  * Private Functions																			   *
 \***************************************************************************************************/
 
-void Planet::constructUVCoords()
+// World Position interpolated between the previous step and the current one.
+vec3 Planet::getWorldPosition( float fAlpha )
 {
-	// Float values for cartesean coordinates
-	float fX, fY, fZ;
-	float fPhi_Rads, fTheta_Rads;
-	vec3 vTop, vBottom;
-	vector<vec3> vMiddleVerts;
-	vector<vec3> vSphereVerts;
-
-	if ( m_bUpdated )
-	{
-		m_vVertices.clear();
-		vTop = vec3( 0.f, m_fRadius, 0.f );
-		vBottom = vec3( 0.f, -m_fRadius, 0.f );
-
-		/*	X = r·sinϕ·cosθ
-			Y = r·sinϕ·sinθ
-			Z = r·cosϕ
-			*/
-		// Calculates Cartesean Coordinates for Triangles in relative coordinates to the Planet.
-		for ( float fPhi = SLICE_SIZE; fPhi < MAX_PHI_DEGS; fPhi += SLICE_SIZE )
-		{
-			fPhi_Rads = fPhi * PI / 180.f;
-
-			for ( float fTheta = 0.f; fTheta < MAX_THETA_DEGS; fTheta += SLICE_SIZE )
-			{
-				fTheta_Rads = fTheta * PI / 180.f;
-				fZ = m_fRadius * sin( fPhi_Rads );	// Z = r·sinϕ
-				fX = fZ * sin( fTheta_Rads );		// use Z for X = r·sinϕ·sinθ
-				fX = abs( fX ) < FLT_EPSILON ? 0.f : fX;
-				fZ *= cos( fTheta_Rads );			// Finish Z: Z = r·sinϕ·cosθ
-				fZ = abs( fZ ) < FLT_EPSILON ? 0.f : fZ;
-				fY = (m_fRadius * cos( fPhi_Rads ));	// Y: r·cosϕ
-				fY = abs( fY ) < FLT_EPSILON ? 0.f : fY;
-				
-				// Add the Coordinate.
-				vMiddleVerts.push_back( vec3( fX, fY, fZ ) );
-				vSphereVerts.push_back( vec3( fPhi, fTheta, m_fRadius ) );
-			}
-		}
-
-		// Gathered all Points on Sphere.
-		for ( unsigned int i = 0; i < (unsigned int)MAX_THETA_CUTS; ++i )
-		{
-			int i_Nxt = (i + 1) % MAX_THETA_CUTS;
-			add3DVertex( vMiddleVerts[i][X], vMiddleVerts[i][Y], vMiddleVerts[i][Z] );
-			addColor( vSphereVerts[i][X], vSphereVerts[i][Y], vSphereVerts[i][Z] );
-			add3DVertex( vTop[X], vTop[Y], vTop[Z] );
-			if ( MAX_THETA_CUTS - 1 == i )
-				addColor( 0.f, vSphereVerts[i_Nxt][Y] + 360.f, vSphereVerts[i_Nxt][Z] );
-			else
-				addColor( 0.f, vSphereVerts[i_Nxt][Y], vSphereVerts[i_Nxt][Z] );
-			add3DVertex( vMiddleVerts[i_Nxt][X], vMiddleVerts[i_Nxt][Y], vMiddleVerts[i_Nxt][Z] );
-			if ( MAX_THETA_CUTS - 1 == i )
-				addColor( vSphereVerts[i_Nxt][X], vSphereVerts[i][Y] + SLICE_SIZE, vSphereVerts[i_Nxt][Z] );
-			else
-				addColor( vSphereVerts[i_Nxt][X], vSphereVerts[i_Nxt][Y], vSphereVerts[i_Nxt][Z] );
-		}
-		for ( unsigned int i = 0; i < vMiddleVerts.size() - MAX_THETA_CUTS; i += MAX_THETA_CUTS )
-			for ( unsigned int p = 0; p < MAX_THETA_CUTS; ++p )
-			{
-				// Forward Looking Variables
-				int p_Next = (p + 1) % MAX_THETA_CUTS;
-				int i_Next = i + MAX_THETA_CUTS;
-		
-				// Add Square Cut
-				// Triangle 1
-				/*
-					P1
-					|\
-					| \
-					P3_P2
-				*/
-				add3DVertex( vMiddleVerts[i + p][X], vMiddleVerts[i + p][Y], vMiddleVerts[i + p][Z] );									// P1
-				addColor( vSphereVerts[i + p][X], vSphereVerts[i + p][Y], vSphereVerts[i + p][Z] );
-				add3DVertex( vMiddleVerts[i_Next + p_Next][X], vMiddleVerts[i_Next + p_Next][Y], vMiddleVerts[i_Next + p_Next][Z] );	// P2
-				if ( 0 == p_Next )
-					addColor( vSphereVerts[i_Next + p_Next][X], vSphereVerts[i_Next + p][Y] + SLICE_SIZE, vSphereVerts[i_Next + p_Next][Z] );
-				else
-					addColor( vSphereVerts[i_Next + p_Next][X], vSphereVerts[i_Next + p_Next][Y], vSphereVerts[i_Next + p_Next][Z] );
-				add3DVertex( vMiddleVerts[i_Next + p][X], vMiddleVerts[i_Next + p][Y], vMiddleVerts[i_Next + p][Z] );					// P3
-				addColor( vSphereVerts[i_Next + p][X], vSphereVerts[i_Next + p][Y], vSphereVerts[i_Next + p][Z] );
-				// Triangle 2
-				/*
-					P1_P2
-					 \ |
-					  \|
-					  P3
-				*/
-				add3DVertex( vMiddleVerts[i + p][X], vMiddleVerts[i + p][Y], vMiddleVerts[i + p][Z] );									// P1
-				addColor( vSphereVerts[i + p][X], vSphereVerts[i + p][Y], vSphereVerts[i + p][Z] );
-				add3DVertex( vMiddleVerts[i + p_Next][X], vMiddleVerts[i + p_Next][Y], vMiddleVerts[i + p_Next][Z] );					// P2
-				if ( 0 == p_Next )
-					addColor( vSphereVerts[i + p_Next][X], vSphereVerts[i + p][Y] + SLICE_SIZE, vSphereVerts[i + p_Next][Z] );
-				else
-					addColor( vSphereVerts[i + p_Next][X], vSphereVerts[i + p_Next][Y], vSphereVerts[i + p_Next][Z] );
-				add3DVertex( vMiddleVerts[i_Next + p_Next][X], vMiddleVerts[i_Next + p_Next][Y], vMiddleVerts[i_Next + p_Next][Z] );	// P3
-				if ( 0 == p_Next )
-					addColor( vSphereVerts[i_Next + p_Next][X], vSphereVerts[i_Next + p][Y] + SLICE_SIZE, vSphereVerts[i_Next + p_Next][Z] );
-				else
-					addColor( vSphereVerts[i_Next + p_Next][X], vSphereVerts[i_Next + p_Next][Y], vSphereVerts[i_Next + p_Next][Z] );
-			}
-		
-		// Evaluate Bottom Cap
-		// Gathered all Points on Sphere.
-		for ( unsigned int i = vMiddleVerts.size() - MAX_THETA_CUTS; i < vMiddleVerts.size(); ++i )
-		{
-			unsigned int i_Nxt = (i + 1);
-			i_Nxt = i_Nxt >= vMiddleVerts.size() ? vMiddleVerts.size() - MAX_THETA_CUTS : i_Nxt;
-			add3DVertex( vMiddleVerts[i][X], vMiddleVerts[i][Y], vMiddleVerts[i][Z] );
-			addColor( vSphereVerts[i][X], vSphereVerts[i][Y], vSphereVerts[i][Z] );
-			add3DVertex( vMiddleVerts[i_Nxt][X], vMiddleVerts[i_Nxt][Y], vMiddleVerts[i_Nxt][Z] );
-			if ( vMiddleVerts.size() - MAX_THETA_CUTS == i_Nxt )
-				addColor( vSphereVerts[i_Nxt][X], vSphereVerts[i_Nxt][Y] + 360.0f, vSphereVerts[i_Nxt][Z] );
-			else
-				addColor( vSphereVerts[i_Nxt][X], vSphereVerts[i_Nxt][Y], vSphereVerts[i_Nxt][Z] );
-			add3DVertex( vBottom[X], vBottom[Y], vBottom[Z] );
-			if ( vMiddleVerts.size() - MAX_THETA_CUTS == i_Nxt )
-				addColor( 180.f, vSphereVerts[i_Nxt][Y] + 360.0f, vSphereVerts[i_Nxt][Z] );
-			else
-				addColor( 180.f, vSphereVerts[i_Nxt][Y], vSphereVerts[i_Nxt][Z] );
-		}
-
-		m_iNumTris = m_vVertices.size() / 3;
-
-		m_bUpdated = false;
-	}
+	return mix( m_vPrevWorldPos, vec3( getWorldMatrix()[3] ), fAlpha );
 }
 
-void Planet::setLocalTransform( ShaderManager* pShdrMngr )
+// Spin in degrees interpolated the short way around, rotation is kept in [0, 360).
+float Planet::getSpin( float fAlpha )
 {
-	mat4 pRotation = rotate( mat4( 1.f ), m_fCurrRotation, vec3( 0, 1, 0 ) );
-	mat4 pTransform = m_AxialTilt * pRotation;
-	pShdrMngr->setLocalTransform( pRotation );
+	float fDelta = m_fCurrRotation - m_fPrevRotation;
+	fDelta = fDelta < -180.f ? fDelta + 360.f : (fDelta > 180.f ? fDelta - 360.f : fDelta);
+
+	return m_fPrevRotation + fDelta * fAlpha;
 }
 
-// Adds a 3D vertex for the cartesian uv-coordinates 
-void Planet::add3DVertex( float fX, float fY, float fZ )
+// Local Rotation (Axial Tilt, then Spin) of the Planet that also scales the Unit Sphere up to the
+//	Planet's Radius.  The Tilt stays local so it doesn't incline the orbits of the Planet's satellites.
+mat4 Planet::getLocalTransform( float fAlpha )
 {
-	m_vVertices.push_back( fX );
-	m_vVertices.push_back( fY );
-	m_vVertices.push_back( fZ );
+	mat4 pRotation = mat4_cast( m_qAxialTilt ) * rotate( mat4( 1.f ), getSpin( fAlpha ), vec3( 0, 1, 0 ) );
+	mat4 pScale = scale( mat4( 1.f ), vec3( m_fRadius ) );
+	return pRotation * pScale;
 }
 
-// Adds a 3D vertex for the cartesian uv-coordinates 
-void Planet::addColor( float fX, float fY, float fZ )
+// Saves the pose of the last step, the World Matrix must still be the one from that step.
+void Planet::beginStep()
 {
-	m_vColors.push_back( fX );
-	m_vColors.push_back( fY );
-	m_vColors.push_back( fZ );
+	m_vPrevWorldPos = vec3( getWorldMatrix()[3] );
+	m_fPrevRotation = m_fCurrRotation;
 }
 
-// rotates Planet's Axis as well as orbit around its parent body.
-void Planet::updatePlanet()
+// Spins the Planet about its Axis and moves it along its orbit around its parent body.  Both are
+//	functions of dSimTime only, so they never drift however the time was reached.
+void Planet::update( double dSimTime, const OrbitSystem* pOrbits )
 {
-	// Evaluate New Rotations based on Speed.
-	clock_t mTimeNow = clock();
+	m_fCurrRotation = (float)fmod( dSimTime * m_fRotPerFrame, 360.0 );
 
-	if ( m_bAnimate )
+	// Bodies that don't orbit leave their Transformation alone.
+	if ( INVALID_ORBIT != m_iOrbit )
 	{
-		float fAdjustedOrbit = m_bFastForward ? m_fOrbitPerFrame * FF_SPEED : m_fOrbitPerFrame;
-		float fAdjustedRotation = m_bFastForward ? m_fRotPerFrame * FF_SPEED : m_fRotPerFrame;
-		float fElapsedTime = (float)(mTimeNow - m_pLastTick) / CLOCKS_PER_SEC;
-		float fPercentofSecond = fElapsedTime / FRAMES_PER_SECOND;
-		mat4 mOrbitDelta = rotate( mat4( 1.f ), fAdjustedOrbit * fPercentofSecond, vec3( 0, 1, 0 ) );
-
-		// Update Current Axis Rotation
-		m_fCurrRotation += fAdjustedRotation * fPercentofSecond;
-		m_fCurrRotation = m_fCurrRotation >= 360.f ? m_fCurrRotation - 360.f : m_fCurrRotation;
-	
-		// Update Orbit Rotation
-		m_pTransform->updateRotation( mOrbitDelta );
+		Transformation* pTransform = m_pSceneGraph->getTransformation( m_hTransform );
+
+		if ( NULL != pTransform )
+			pTransform->setTranslation( pOrbits->getPosition( m_iOrbit ) );
 	}
+}
 
-	m_pLastTick = clock();
-}
\ No newline at end of file
+// World Matrix of the Planet's Transformation.  Once the node has been removed the Planet stays
+//	at its last position, unrotated.
+mat4 Planet::getWorldMatrix()
+{
+	Transformation* pTransform = m_pSceneGraph->getTransformation( m_hTransform );
+
+	return NULL != pTransform ? pTransform->getTransformationMatrix( true ) : translate( mat4( 1.f ), m_vPrevWorldPos );
+}
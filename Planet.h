@@ -3,6 +3,8 @@
 // Includes
 #include "stdafx.h"
 #include "ImageReader.h"
+#include "GeometryManager.h"
+#include "SceneGraph.h"
 
 // Spherical Coordinates indicies
 #define THETA 0
@@ -13,25 +15,49 @@
 #define LOG_BASE log(BASE)
 
 // Forward Declarations
-class Transformation;
 class ShaderManager;
+class Camera;
+class OrbitSystem;
+class RenderQueue;
 
 class Planet
 {
 public:
 	Planet( float fRadius, 
-			const string& sTextureName, 
-			Transformation* pTransform, 
+			const MyTexture* pTexture, 
+			SceneGraph* pSceneGraph,
+			TransformHandle hTransform,
 			float fAxisTilt, 
 			float fSecsForRotation, 
-			float fSecsForOrbit,
-			bool bLightPlanet );
+			unsigned int iOrbit,
+			bool bLightPlanet,
+			eSphereTopology eTopology = UV_SPHERE );
 	~Planet();
 
+	// Creates the Planet's GL objects, must run on the Context thread after construction.
+	bool initializeGL();
+
+	// Sets Rotation and Orbit Position for dSimTime, pOrbits must already be evaluated for it.
+	//	Doesn't touch GL, only this Planet and the subtree under its Transformation are written.
+	//	beginStep() keeps the current pose to interpolate from and must run before the Planet or
+	//	any of its ancestors are updated.
+	void beginStep();
+	void update( double dSimTime, const OrbitSystem* pOrbits );
+	TransformHandle getTransform() const { return m_hTransform; }
+
+	// World space Sphere containing the Planet anywhere between the previous and current step.
+	void getBoundingSphere( vec3* pCenter, float* pRadius );
+
 	// Render Functions
-	void renderPlanet();
-	void toggleAnimation()	{ m_bAnimate = !m_bAnimate; }
-	void toggleFastForward() { m_bFastForward = !m_bFastForward; }
+	// fAlpha interpolates between the pose saved by beginStep() (0) and the current pose (1).
+	void queueDraw( RenderQueue* pQueue, float fAlpha, const vec3& vCameraPos );
+	void selectLOD( Camera* pCamera, float fAlpha );
+
+	// Instanced Rendering: the per-Body values queueDraw() sets as Uniforms, and what the
+	//	Planet can be batched by.
+	void getInstanceData( float fAlpha, BodyInstance* pInstance );
+	unsigned int getMeshHandle() const { return m_iMeshLODs[m_iLODLevel]; }
+	GLuint getTextureName() const { return m_pTexture->textureName; }
 
 	// Binds the TextureData on the Planet.
 	void getTextureData( GLsizeiptr* iPtr, void** data );
@@ -41,24 +67,27 @@ private:
 	vec3 m_vPos; // Spherical Positions stored in Spherical Coordinates.
 	GLuint m_pTextCoords[NUM_TEXTURE_COORDS][2];
 	float m_fRadius;
-	int m_iNumTris;
-	MyTexture m_pTexture;
-	Transformation* m_pTransform;
-	bool m_bUpdated, m_bAnimate, m_bFastForward, m_bLightPlanet;
-	vector<GLfloat> m_vVertices;	// Vertices for Drawing Triangles.
-	vector<GLfloat> m_vColors;		// Color Values for Triangles
+	const MyTexture* m_pTexture;	// Shared between Planets, owned by the SceneLoader.
+	eSphereTopology m_eTopology;
+	SceneGraph* m_pSceneGraph;
+	TransformHandle m_hTransform;	// Resolved on every use, a removed node leaves the Planet where it last was
+	unsigned int m_iOrbit;		// Index in the OrbitSystem, INVALID_ORBIT for bodies that don't orbit
+	bool m_bLightPlanet;
+	unsigned int m_iMeshLODs[NUM_SPHERE_LODS];	// Shared Unit Spheres, scaled by m_fRadius when drawn.
+	unsigned int m_iLODLevel;					// Current LOD, 0 is the finest.
 
 	// Localized Rotation
-	mat4 m_AxialTilt;
+	quat m_qAxialTilt;
 	float m_fRotPerFrame, m_fCurrRotation;
-	float m_fOrbitPerFrame;
-	clock_t m_pLastTick;
+
+	// Pose at the previous simulation step
+	vec3 m_vPrevWorldPos;
+	float m_fPrevRotation;
+	vec3 getWorldPosition( float fAlpha );
+	float getSpin( float fAlpha );
 
 	// Private Functions
-	void add3DVertex( float fX, float fY, float fZ );
-	void addColor( float fX, float fY, float fZ );
-	void constructUVCoords();
-	void setLocalTransform( ShaderManager* pShdrMngr );
-	void updatePlanet();
+	mat4 getLocalTransform( float fAlpha );
+	mat4 getWorldMatrix();
 };
 
@@ -0,0 +1,39 @@
+#pragma once
+
+/* INCLUDES */
+#include "stdafx.h"
+#include "GeometryManager.h"
+
+// Uniforms a Packet sets before it draws, for Programs that don't read them from Instances.
+struct DrawUniforms
+{
+	mat4 mToWorld;
+	mat4 mLocalTransform;
+	bool bLight;
+};
+
+// Class: RenderDevice
+// Purpose: The calls the Render Queue submits a frame through.  GLRenderDevice issues them to
+//			OpenGL; NullRenderDevice only records and counts them, so submission can be tested
+//			and profiled without a context or display.
+// Frames are bracketed by beginFrame() and endFrame(), which leaves nothing bound.
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() {}
+
+	virtual void beginFrame() = 0;
+	virtual void endFrame() = 0;
+
+	// State
+	virtual void bindProgram( GLuint iProgram ) = 0;
+	virtual void bindTexture( GLuint iTexture ) = 0;
+	virtual void bindMesh( unsigned int iMesh ) = 0;
+	virtual void setDrawUniforms( const DrawUniforms& pUniforms ) = 0;
+
+	// Every Instance for the frame, drawn in ranges afterwards.
+	virtual void uploadInstances( const vector<BodyInstance>& vInstances ) = 0;
+
+	// Draws the bound Mesh once if iNumInstances is 0, otherwise the Instances from iFirstInstance.
+	virtual void drawMesh( unsigned int iMesh, unsigned int iFirstInstance, unsigned int iNumInstances ) = 0;
+};
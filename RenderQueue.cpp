@@ -0,0 +1,117 @@
+#include "RenderQueue.h"
+
+// Default Constructor
+RenderQueue::RenderQueue()
+{
+	memset( &m_pStats, 0, sizeof( m_pStats ) );
+}
+
+// Destructor
+RenderQueue::~RenderQueue()
+{
+	// Nothing to Destruct
+}
+
+/*******************************************************************\
+ * Recording													   *
+\*******************************************************************/
+
+// Starts a new frame.  Clearing keeps the storage, so steady frames don't allocate.
+void RenderQueue::reset()
+{
+	m_vPackets.clear();
+	m_vUniforms.clear();
+}
+
+// Stores Uniforms for a Packet of this frame and returns their index.
+unsigned int RenderQueue::pushUniforms( const DrawUniforms& pUniforms )
+{
+	m_vUniforms.push_back( pUniforms );
+	return m_vUniforms.size() - 1;
+}
+
+// Records a Packet to be drawn on submit().
+void RenderQueue::push( const DrawPacket& pPacket )
+{
+	m_vPackets.push_back( pPacket );
+}
+
+// Packs the sort order of a Packet into 64 bits, most significant first.  Names too large for
+//	their field only sort less tightly; submit() compares the real names before eliding a bind.
+// Depth uses the top bits of the float, which order like the value for non-negative floats.
+unsigned long long RenderQueue::makeKey( eRenderLayer eLayer, GLuint iProgram, GLuint iTexture, unsigned int iMesh, float fDepth )
+{
+	unsigned int iDepthBits;
+	unsigned long long iKey;
+
+	fDepth = fDepth > 0.f ? fDepth : 0.f;
+	memcpy( &iDepthBits, &fDepth, sizeof( iDepthBits ) );
+
+	iKey = (unsigned long long)eLayer & ((1ULL << LAYER_KEY_BITS) - 1);
+	iKey = (iKey << PROGRAM_KEY_BITS) | (iProgram & ((1ULL << PROGRAM_KEY_BITS) - 1));
+	iKey = (iKey << TEXTURE_KEY_BITS) | (iTexture & ((1ULL << TEXTURE_KEY_BITS) - 1));
+	iKey = (iKey << MESH_KEY_BITS) | (iMesh & ((1ULL << MESH_KEY_BITS) - 1));
+	iKey = (iKey << DEPTH_KEY_BITS) | (iDepthBits >> (32 - 1 - DEPTH_KEY_BITS));	// Sign bit is always 0
+
+	return iKey;
+}
+
+/*******************************************************************\
+ * Submission													   *
+\*******************************************************************/
+
+// Sorts the Packets and draws them.  State carried over from the previous Packet isn't bound
+//	again; what the queue found bound before it started is never assumed.
+void RenderQueue::submit( RenderDevice* pDevice )
+{
+	GLuint iBoundProgram = 0, iBoundTexture = 0;
+	unsigned int iBoundMesh = UINT_MAX;
+	bool bTextureBound = false;
+
+	memset( &m_pStats, 0, sizeof( m_pStats ) );
+	m_pStats.iNumPackets = m_vPackets.size();
+
+	// Sort indices rather than the Packets themselves, ties keep recording order.
+	m_vSortedPackets.resize( m_vPackets.size() );
+	for ( unsigned int i = 0; i < m_vPackets.size(); ++i )
+		m_vSortedPackets[i] = make_pair( m_vPackets[i].iKey, i );
+	sort( m_vSortedPackets.begin(), m_vSortedPackets.end() );
+
+	for ( unsigned int i = 0; i < m_vSortedPackets.size(); ++i )
+	{
+		const DrawPacket& pPacket = m_vPackets[m_vSortedPackets[i].second];
+
+		if ( pPacket.iProgram != iBoundProgram )
+		{
+			pDevice->bindProgram( pPacket.iProgram );
+			iBoundProgram = pPacket.iProgram;
+			++m_pStats.iProgramBinds;
+		}
+		else
+			++m_pStats.iProgramBindsAvoided;
+
+		if ( !bTextureBound || pPacket.iTexture != iBoundTexture )
+		{
+			pDevice->bindTexture( pPacket.iTexture );
+			iBoundTexture = pPacket.iTexture;
+			bTextureBound = true;
+			++m_pStats.iTextureBinds;
+		}
+		else
+			++m_pStats.iTextureBindsAvoided;
+
+		if ( pPacket.iMesh != iBoundMesh )
+		{
+			pDevice->bindMesh( pPacket.iMesh );
+			iBoundMesh = pPacket.iMesh;
+			++m_pStats.iMeshBinds;
+		}
+		else
+			++m_pStats.iMeshBindsAvoided;
+
+		if ( INVALID_DRAW_UNIFORMS != pPacket.iUniforms )
+			pDevice->setDrawUniforms( m_vUniforms[pPacket.iUniforms] );
+
+		pDevice->drawMesh( pPacket.iMesh, pPacket.iFirstInstance, pPacket.iNumInstances );
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+/* INCLUDES */
+#include "stdafx.h"
+#include "RenderDevice.h"
+
+/* DEFINES */
+#define INVALID_DRAW_UNIFORMS	UINT_MAX
+#define DEPTH_KEY_BITS			24
+#define MESH_KEY_BITS			16
+#define TEXTURE_KEY_BITS		14
+#define PROGRAM_KEY_BITS		6
+#define LAYER_KEY_BITS			4		// Adds up to 64 with the others
+
+// Layers are drawn in order, everything else is sorted within them.
+enum eRenderLayer
+{
+	OPAQUE_LAYER = 0,
+	MAX_RENDER_LAYERS
+};
+
+// One recorded draw: everything it binds and what it draws.  iNumInstances of 0 draws the Mesh
+//	once, otherwise the Instances from iFirstInstance in the GeometryManager's Instance buffer.
+struct DrawPacket
+{
+	unsigned long long iKey;
+	GLuint iProgram;
+	GLuint iTexture;
+	unsigned int iMesh;
+	unsigned int iFirstInstance;
+	unsigned int iNumInstances;
+	unsigned int iUniforms;		// Index of its DrawUniforms, INVALID_DRAW_UNIFORMS if it has none
+};
+
+// Binds issued and avoided by the last submitted frame.
+struct RenderQueueStats
+{
+	unsigned int iNumPackets;
+	unsigned int iProgramBinds, iProgramBindsAvoided;
+	unsigned int iTextureBinds, iTextureBindsAvoided;
+	unsigned int iMeshBinds, iMeshBindsAvoided;
+};
+
+// Class: RenderQueue
+// Purpose: Records a frame's draws as Packets instead of issuing them immediately, sorts them by
+//			(layer, program, texture, mesh, depth) and submits them, only binding what differs
+//			from the previous Packet.  The Packets and their Uniforms live in storage that is
+//			reset, not freed, every frame.
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	// Recording, the returned index of pushUniforms() goes in a Packet's iUniforms.
+	void reset();
+	unsigned int pushUniforms( const DrawUniforms& pUniforms );
+	void push( const DrawPacket& pPacket );
+	unsigned int getNumPackets() const { return m_vPackets.size(); }
+
+	// Sorts and issues every recorded Packet to pDevice, within the Device's current frame.
+	void submit( RenderDevice* pDevice );
+	const RenderQueueStats& getStats() const { return m_pStats; }
+
+	// Opaque draws should pass their distance to the Camera so they're drawn front to back.
+	static unsigned long long makeKey( eRenderLayer eLayer, GLuint iProgram, GLuint iTexture, unsigned int iMesh, float fDepth );
+
+private:
+	// Frame-local storage
+	vector< DrawPacket > m_vPackets;
+	vector< DrawUniforms > m_vUniforms;
+	vector< pair< unsigned long long, unsigned int > > m_vSortedPackets;	// Key -> m_vPackets index
+
+	RenderQueueStats m_pStats;
+};
@@ -1,14 +1,28 @@
 #include "SceneGraph.h"
+#include "ThreadPool.h"
 
 // 
 SceneGraph::SceneGraph()
 {
 	m_pWorld = new Transformation( vec3( 0.f, 0.f, 0.f ) );
+
+	// The root never moves, caching it now means subtree updates never write to it.
+	m_pWorld->getTransformationMatrix( true );
 }
 
 // Destructor
 SceneGraph::~SceneGraph()
 {
+	while ( NULL != m_pWorld->m_pFirstChild )
+	{
+		Transformation* pRoot = m_pWorld->m_pFirstChild;
+		m_pWorld->m_pFirstChild = pRoot->m_pNextSibling;
+		freeSubtree( pRoot );
+	}
+
+	for ( unsigned int i = 0; i < m_pChunks.size(); ++i )
+		::operator delete( m_pChunks[i] );
+
 	if ( NULL != m_pWorld )
 		delete m_pWorld;
 }
@@ -16,36 +30,187 @@ SceneGraph::~SceneGraph()
 /************************************************************************\
  * Graph Manipulation                                                   *
 \************************************************************************/
-void SceneGraph::addTransformation( Transformation* pNewTransform, Transformation* pParent )
+
+// Creates a node under hParent (or the World root) and returns its Handle.  Returns
+//	INVALID_TRANSFORM if hParent is stale.  Only allocates when every chunk is full.
+TransformHandle SceneGraph::addTransformation( vec3 vTranslation, TransformHandle hParent )
 {
-	if ( NULL != pNewTransform )
-	{
-		// Set Parent
-		if ( NULL == pParent )
-			pNewTransform->m_pParent = m_pWorld;
-		else
-			pNewTransform->m_pParent = pParent;
+	Transformation* pParent = INVALID_TRANSFORM == hParent ? m_pWorld : getTransformation( hParent );
+	Transformation* pNewTransform;
+	unsigned int iIndex;
 
-		// Add new transform to Parent's Child List
-		pNewTransform->m_pParent->m_pChildren.push_back( pNewTransform );
+	if ( NULL == pParent )
+	{
+		cout << "Error: Attempted to add a Transformation under a removed Parent." << endl;
+		return INVALID_TRANSFORM;
 	}
+
+	if ( m_vFreeSlots.empty() )
+		addChunk();
+
+	iIndex = m_vFreeSlots.back();
+	m_vFreeSlots.pop_back();
+
+	pNewTransform = new ( getSlot( iIndex ) ) Transformation( vTranslation );
+	pNewTransform->m_iPoolIndex = iIndex;
+
+	// Append to Parent's Child List
+	pNewTransform->m_pParent = pParent;
+	pNewTransform->m_pPrevSibling = pParent->m_pLastChild;
+	if ( NULL != pParent->m_pLastChild )
+		pParent->m_pLastChild->m_pNextSibling = pNewTransform;
+	else
+		pParent->m_pFirstChild = pNewTransform;
+	pParent->m_pLastChild = pNewTransform;
+
+	adjustSubtreeSizes( pParent, 1 );
+
+	return makeHandle( iIndex );
 }
 
-// Delete a given Transformation
-void SceneGraph::removeTransformation( Transformation* pRemovalPtr )
+// Removes a node along with its subtree.  Unlinking is constant time, the subtree's slots are
+//	returned to the pool and every Handle to them goes stale.
+bool SceneGraph::removeTransformation( TransformHandle hNode )
 {
+	Transformation* pRemovalPtr = getTransformation( hNode );
 	Transformation* pParent;
 
-	if ( NULL != pRemovalPtr && NULL != pRemovalPtr->m_pParent )  // Exists with a Parent
+	if ( NULL == pRemovalPtr )
+		return false;
+
+	pParent = pRemovalPtr->m_pParent;
+	adjustSubtreeSizes( pParent, -(int)pRemovalPtr->m_iSubtreeSize );
+
+	// Unlink from Siblings
+	if ( NULL != pRemovalPtr->m_pPrevSibling )
+		pRemovalPtr->m_pPrevSibling->m_pNextSibling = pRemovalPtr->m_pNextSibling;
+	else
+		pParent->m_pFirstChild = pRemovalPtr->m_pNextSibling;
+
+	if ( NULL != pRemovalPtr->m_pNextSibling )
+		pRemovalPtr->m_pNextSibling->m_pPrevSibling = pRemovalPtr->m_pPrevSibling;
+	else
+		pParent->m_pLastChild = pRemovalPtr->m_pPrevSibling;
+
+	freeSubtree( pRemovalPtr );
+
+	return true;
+}
+
+// Makes sure iNumNodes can be held without allocating.
+void SceneGraph::reserve( unsigned int iNumNodes )
+{
+	while ( m_vGenerations.size() < iNumNodes )
+		addChunk();
+}
+
+/************************************************************************\
+ * Handle Lookup                                                        *
+\************************************************************************/
+
+// A Handle is valid if its slot exists and hasn't been freed since the Handle was issued.
+bool SceneGraph::isValid( TransformHandle hNode ) const
+{
+	unsigned int iIndex = (unsigned int)(hNode & 0xFFFFFFFF);
+	unsigned int iGeneration = (unsigned int)(hNode >> 32);
+
+	return iIndex < m_vGenerations.size() && m_vGenerations[iIndex] == iGeneration;
+}
+
+// Returns the node a Handle refers to, or NULL if it was removed.
+Transformation* SceneGraph::getTransformation( TransformHandle hNode ) const
+{
+	return isValid( hNode ) ? getSlot( (unsigned int)(hNode & 0xFFFFFFFF) ) : NULL;
+}
+
+/************************************************************************\
+ * Graph Update                                                         *
+\************************************************************************/
+
+// Updates the World Matrices top-down, on the calling thread for small graphs.
+void SceneGraph::updateWorldMatrices( ThreadPool* pPool )
+{
+	if ( NULL == pPool || getNumNodes() < PARALLEL_UPDATE_MIN_NODES )
+		updateSubtree( m_pWorld, NULL );
+	else
 	{
-		pParent = pRemovalPtr->m_pParent;
-		pParent->m_pChildren.erase( remove( pParent->m_pChildren.begin(), pParent->m_pChildren.end(), pRemovalPtr ), pParent->m_pChildren.end() );
-		delete pRemovalPtr;
-		pRemovalPtr = NULL;
+		pPool->addJob( [this, pPool]() { updateSubtree( m_pWorld, pPool ); } );
+		pPool->waitForAll();
 	}
-	else if ( NULL != pRemovalPtr && pRemovalPtr != m_pWorld )  // Just delete it if there's no parent
+}
+
+// Updates pNode then its children, pNode's Parent must already be current.  A child's subtree is
+//	independent of its siblings', so large ones become jobs of their own once pNode is done;
+//	the rest are walked by this job.
+void SceneGraph::updateSubtree( Transformation* pNode, ThreadPool* pPool )
+{
+	pNode->getTransformationMatrix( true );
+
+	for ( Transformation* pChild = pNode->m_pFirstChild; NULL != pChild; pChild = pChild->m_pNextSibling )
 	{
-		delete pRemovalPtr;
-		pRemovalPtr = NULL;
+		if ( NULL != pPool && pChild->m_iSubtreeSize >= SUBTREE_TASK_MIN_NODES )
+			pPool->addJob( [this, pChild, pPool]() { updateSubtree( pChild, pPool ); } );
+		else
+			updateSubtree( pChild, pPool );
 	}
 }
+
+// Returns the ancestor of pNode (or pNode itself) directly under the World root.  Nodes with
+//	different Subtree Roots share no state and can be updated concurrently.
+Transformation* SceneGraph::getSubtreeRoot( Transformation* pNode ) const
+{
+	while ( NULL != pNode && NULL != pNode->m_pParent && m_pWorld != pNode->m_pParent )
+		pNode = pNode->m_pParent;
+
+	return pNode;
+}
+
+// Handle of the Subtree Root above hNode, INVALID_TRANSFORM if hNode is stale.
+TransformHandle SceneGraph::getSubtreeRoot( TransformHandle hNode ) const
+{
+	Transformation* pRoot = getSubtreeRoot( getTransformation( hNode ) );
+
+	return NULL != pRoot ? makeHandle( pRoot->m_iPoolIndex ) : INVALID_TRANSFORM;
+}
+
+/************************************************************************\
+ * Node Pool                                                            *
+\************************************************************************/
+
+// Allocates another TRANSFORM_CHUNK_SIZE slots.  The free list is sized for every slot up front
+//	so releasing nodes never allocates.
+void SceneGraph::addChunk()
+{
+	unsigned int iFirstIndex = m_vGenerations.size();
+
+	m_pChunks.push_back( static_cast<Transformation*>( ::operator new( TRANSFORM_CHUNK_SIZE * sizeof( Transformation ) ) ) );
+	m_vGenerations.resize( iFirstIndex + TRANSFORM_CHUNK_SIZE, 0 );
+	m_vFreeSlots.reserve( m_vGenerations.size() );
+
+	for ( unsigned int i = TRANSFORM_CHUNK_SIZE; i > 0; --i )
+		m_vFreeSlots.push_back( iFirstIndex + i - 1 );
+}
+
+// Returns pNode and its descendants to the pool, pNode must already be unlinked from its Parent.
+void SceneGraph::freeSubtree( Transformation* pNode )
+{
+	Transformation* pChild = pNode->m_pFirstChild;
+
+	while ( NULL != pChild )
+	{
+		Transformation* pNext = pChild->m_pNextSibling;
+		freeSubtree( pChild );
+		pChild = pNext;
+	}
+
+	++m_vGenerations[pNode->m_iPoolIndex];
+	m_vFreeSlots.push_back( pNode->m_iPoolIndex );
+	pNode->~Transformation();
+}
+
+// Adds iDelta to the Subtree Size of pNode and all its ancestors.
+void SceneGraph::adjustSubtreeSizes( Transformation* pNode, int iDelta )
+{
+	for ( ; NULL != pNode; pNode = pNode->m_pParent )
+		pNode->m_iSubtreeSize += iDelta;
+}
@@ -2,7 +2,22 @@
 #include "stdafx.h"
 #include "Transformation.h"
 
+// Forward Declarations
+class ThreadPool;
+
+/* DEFINES */
+#define PARALLEL_UPDATE_MIN_NODES	512		// Smaller graphs are updated on the calling thread.
+#define SUBTREE_TASK_MIN_NODES		64		// Smaller subtrees are updated inline by their parent's task.
+#define TRANSFORM_CHUNK_SIZE		256		// Nodes allocated per pool chunk.
+#define INVALID_TRANSFORM			0xFFFFFFFFFFFFFFFFull
+
+// Generational Handle to a pooled Transformation: pool index in the low 32 bits, the slot's
+//	generation in the high 32.  Removing a node bumps its slot's generation, so old handles go stale.
+typedef unsigned long long TransformHandle;
+
 // Manages Different Translations
+// Nodes are allocated from chunks owned by the graph.  Chunks never move, so a node's address is
+//	stable until it's removed, and freed slots are reused before new chunks are allocated.
 class SceneGraph
 {
 public:
@@ -10,12 +25,37 @@ public:
 	~SceneGraph();
 
 	// Graph Manipulation
-	void addTransformation( Transformation* pNewTransform, Transformation* pParent );
-	void removeTransformation( Transformation* pRemovalPtr );
+	// hParent = INVALID_TRANSFORM attaches the new node to the World root.
+	TransformHandle addTransformation( vec3 vTranslation, TransformHandle hParent );
+	bool removeTransformation( TransformHandle hNode );
+	void reserve( unsigned int iNumNodes );
+
+	// Handle Lookup, returns NULL for a stale or invalid Handle.
+	bool isValid( TransformHandle hNode ) const;
+	Transformation* getTransformation( TransformHandle hNode ) const;
+
+	// Brings every World Matrix up to date.  Independent subtrees are spread across the pool;
+	//	each node reads only its own Parent, so results are identical to a serial update.
+	void updateWorldMatrices( ThreadPool* pPool );
+	void updateSubtree( Transformation* pNode, ThreadPool* pPool );
+	Transformation* getSubtreeRoot( Transformation* pNode ) const;
+	TransformHandle getSubtreeRoot( TransformHandle hNode ) const;
+	Transformation* getFirstSubtreeRoot() const { return m_pWorld->m_pFirstChild; }
+	unsigned int getNumNodes() const { return m_pWorld->m_iSubtreeSize; }
 
 private:
 	// This root can never be removed.
 	Transformation* m_pWorld;
+
+	// Node Pool
+	vector<Transformation*> m_pChunks;
+	vector<unsigned int> m_vGenerations;	// Per slot, bumped when the slot is freed
+	vector<unsigned int> m_vFreeSlots;		// Next slot to reuse on top
+	Transformation* getSlot( unsigned int iIndex ) const { return &m_pChunks[iIndex / TRANSFORM_CHUNK_SIZE][iIndex % TRANSFORM_CHUNK_SIZE]; }
+	TransformHandle makeHandle( unsigned int iIndex ) const { return ((TransformHandle)m_vGenerations[iIndex] << 32) | iIndex; }
+	void addChunk();
+	void freeSubtree( Transformation* pNode );
+
+	void adjustSubtreeSizes( Transformation* pNode, int iDelta );
 	
 };
-
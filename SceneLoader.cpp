@@ -0,0 +1,303 @@
+#include "SceneLoader.h"
+#include "Planet.h"
+#include "ThreadPool.h"
+
+// Topology names as written in a Scene File, indexed by eSphereTopology.
+const char* c_pSceneTopologies[MAX_TOPOLOGIES] = { "uv", "ico", "cube" };
+
+// Constructor
+SceneLoader::SceneLoader( SceneGraph* pSceneGraph, OrbitSystem* pOrbits )
+{
+	m_pSceneGraph = pSceneGraph;
+	m_pOrbits = pOrbits;
+	m_pPlanets = NULL;
+	m_iLineNumber = 0;
+	m_iNumDeclared = 0;
+	m_iNumLoaded = 0;
+}
+
+// Destructor, releases every cached Texture.
+SceneLoader::~SceneLoader()
+{
+	close();
+
+	for ( map< string, MyTexture* >::iterator pIter = m_pTextures.begin(); pIter != m_pTextures.end(); ++pIter )
+	{
+		glDeleteTextures( 1, &pIter->second->textureName );
+		delete pIter->second;
+	}
+
+	m_pSceneGraph = NULL;
+	m_pOrbits = NULL;
+	m_pPlanets = NULL;
+}
+
+/************************************************************************\
+ * Streaming                                                            *
+\************************************************************************/
+
+// Reads the header of sFileName, reserves room for the bodies it declares and loads the
+//	Textures it lists (decoded across the pool, uploaded here).  New Planets are appended to
+//	pPlanets by loadChunk().
+bool SceneLoader::open( const string& sFileName, vector<Planet*>* pPlanets )
+{
+	string sLine;
+	vector<string> vTextureNames;
+	ThreadPool* pPool = ThreadPool::getInstance();
+
+	close();
+	m_pFile.open( sFileName.c_str() );
+	m_sFileName = sFileName;
+	m_pPlanets = pPlanets;
+	m_iLineNumber = 0;
+	m_iNumDeclared = 0;
+	m_iNumLoaded = 0;
+
+	if ( !m_pFile.is_open() )
+	{
+		cout << "Error: Unable to open Scene File " << sFileName << "." << endl;
+		return false;
+	}
+
+	// Header
+	if ( !readLine( sLine ) || 1 != sscanf( sLine.c_str(), "bodies %u", &m_iNumDeclared ) )
+	{
+		cout << "Error: " << sFileName << " is missing its \"bodies <count>\" header." << endl;
+		close();
+		return false;
+	}
+
+	m_pPlanets->reserve( m_pPlanets->size() + m_iNumDeclared );
+	m_pSceneGraph->reserve( m_pSceneGraph->getNumNodes() + m_iNumDeclared );
+	m_pOrbits->reserve( m_pOrbits->getNumOrbits() + m_iNumDeclared );
+
+	// Textures listed up front
+	while ( readLine( sLine ) )
+	{
+		char cTexture[SCENE_PATH_LENGTH];
+
+		if ( 1 != sscanf( sLine.c_str(), "texture %255s", cTexture ) )
+		{
+			m_sPendingLine = sLine;
+			break;
+		}
+
+		if ( m_pTextures.end() == m_pTextures.find( cTexture ) )
+		{
+			m_pTextures[cTexture] = NULL;
+			vTextureNames.push_back( cTexture );
+		}
+	}
+
+	vector<MyImage> vImages( vTextureNames.size() );
+	for ( unsigned int i = 0; i < vTextureNames.size(); ++i )
+	{
+		pPool->addJob( [&vImages, &vTextureNames, i]()
+		{
+			if ( !DecodeImage( &vImages[i], vTextureNames[i] ) )
+				cout << "Error: Unable to decode " << vTextureNames[i] << "." << endl;
+		} );
+	}
+	pPool->waitForAll();
+
+	for ( unsigned int i = 0; i < vTextureNames.size(); ++i )
+	{
+		MyTexture* pTexture = new MyTexture();
+		UploadTexture( pTexture, vImages[i] );
+		m_pTextures[vTextureNames[i]] = pTexture;
+	}
+
+	return true;
+}
+
+// Creates bodies until the file ends or dBudgetSecs have passed.  Returns true while there's
+//	more of the file left to load.
+bool SceneLoader::loadChunk( double dBudgetSecs )
+{
+	chrono::steady_clock::time_point mStart = chrono::steady_clock::now();
+	string sLine;
+	unsigned int iCount = 0;
+
+	while ( isLoading() )
+	{
+		if ( !m_sPendingLine.empty() )
+		{
+			sLine.swap( m_sPendingLine );
+			m_sPendingLine.clear();
+		}
+		else if ( !readLine( sLine ) )
+		{
+			if ( m_iNumLoaded != m_iNumDeclared )
+				cout << "Warning: " << m_sFileName << " declared " << m_iNumDeclared << " bodies but contained " << m_iNumLoaded << "." << endl;
+
+			close();
+			break;
+		}
+
+		if ( 0 == sLine.compare( 0, 6, "orbit " ) ? !parseOrbit( sLine ) : !parseEntry( sLine ) )
+			cout << "Error: " << m_sFileName << "(" << m_iLineNumber << "): Unable to parse \"" << sLine << "\"." << endl;
+
+		// Only check the clock every so often, it costs as much as creating a body.
+		if ( 0 == ++iCount % SCENE_BUDGET_CHECK && chrono::duration<double>( chrono::steady_clock::now() - mStart ).count() >= dBudgetSecs )
+			break;
+	}
+
+	return isLoading();
+}
+
+/************************************************************************\
+ * Parsing                                                              *
+\************************************************************************/
+
+// Next line that isn't blank or a comment, comments are stripped.
+bool SceneLoader::readLine( string& sLine )
+{
+	while ( getline( m_pFile, sLine ) )
+	{
+		size_t iComment = sLine.find( '#' );
+		++m_iLineNumber;
+
+		if ( string::npos != iComment )
+			sLine.erase( iComment );
+
+		if ( string::npos != sLine.find_first_not_of( " \t\r" ) )
+			return true;
+	}
+
+	return false;
+}
+
+// Creates the Planet (and Transformation) described by a body or attach entry.
+bool SceneLoader::parseEntry( const string& sLine )
+{
+	char cName[SCENE_NAME_LENGTH], cParent[SCENE_NAME_LENGTH], cTopology[SCENE_NAME_LENGTH];
+	char cTexture[SCENE_PATH_LENGTH];
+	float fRadius, fAxialTilt, fSecsForRotation, fSecsForOrbit = 0.f;
+	vec3 vTranslation;
+	int iLit;
+	eSphereTopology eTopology;
+	TransformHandle hTransform, hParent;
+	unsigned int iOrbit = INVALID_ORBIT;
+	bool bBody;
+	Planet* pNewPlanet;
+
+	if ( 12 == sscanf( sLine.c_str(), "body %63s %63s %255s %f %f %f %f %f %f %f %d %63s", cName, cParent, cTexture,
+					   &fRadius, &fAxialTilt, &fSecsForRotation, &fSecsForOrbit,
+					   &vTranslation.x, &vTranslation.y, &vTranslation.z, &iLit, cTopology ) )
+		bBody = true;
+	else if ( 8 == sscanf( sLine.c_str(), "attach %63s %63s %255s %f %f %f %d %63s", cName, cParent, cTexture,
+						   &fRadius, &fAxialTilt, &fSecsForRotation, &iLit, cTopology ) )
+		bBody = false;
+	else
+		return false;
+
+	// Everything that can fail is checked before the Scene Graph is touched, so a bad entry leaves
+	//	no node behind.  Only a body may omit its parent.
+	hParent = findTransform( cParent );
+	if ( !parseTopology( cTopology, &eTopology ) )
+		return false;
+	if ( INVALID_TRANSFORM == hParent && (!bBody || 0 != strcmp( cParent, "-" )) )
+		return false;
+
+	hTransform = bBody ? m_pSceneGraph->addTransformation( vTranslation, hParent ) : hParent;
+	if ( INVALID_TRANSFORM == hTransform )
+		return false;
+
+	// Orbiting bodies start at their listed translation
+	if ( 0.f != fSecsForOrbit )
+		iOrbit = m_pOrbits->addOrbit( OrbitSystem::CircularOrbitThrough( vTranslation ), fSecsForOrbit );
+
+	if ( 0 != strcmp( cName, "-" ) )
+	{
+		m_pNamedTransforms[cName] = hTransform;
+		if ( INVALID_ORBIT != iOrbit )
+			m_pNamedOrbits[cName] = iOrbit;
+	}
+
+	pNewPlanet = new Planet( fRadius, getTexture( cTexture ), m_pSceneGraph, hTransform,
+							 fAxialTilt, fSecsForRotation, iOrbit, 0 != iLit, eTopology );
+	pNewPlanet->initializeGL();
+	m_pPlanets->push_back( pNewPlanet );
+	++m_iNumLoaded;
+
+	return true;
+}
+
+// Replaces the circular orbit of a named body with the elements of an orbit entry, keeping its period.
+bool SceneLoader::parseOrbit( const string& sLine )
+{
+	char cName[SCENE_NAME_LENGTH];
+	OrbitalElements pElements;
+	map< string, unsigned int >::iterator pIter;
+
+	if ( 7 != sscanf( sLine.c_str(), "orbit %63s %f %f %f %f %f %f", cName,
+					  &pElements.fSemiMajorAxis, &pElements.fEccentricity, &pElements.fInclination,
+					  &pElements.fAscendingNode, &pElements.fArgPeriapsis, &pElements.fMeanAnomaly ) )
+		return false;
+
+	pIter = m_pNamedOrbits.find( cName );
+	if ( m_pNamedOrbits.end() == pIter || pElements.fEccentricity < 0.f || pElements.fEccentricity >= MAX_ECCENTRICITY )
+		return false;
+
+	pElements.fInclination = radians( pElements.fInclination );
+	pElements.fAscendingNode = radians( pElements.fAscendingNode );
+	pElements.fArgPeriapsis = radians( pElements.fArgPeriapsis );
+	pElements.fMeanAnomaly = radians( pElements.fMeanAnomaly );
+	m_pOrbits->setOrbit( pIter->second, pElements, m_pOrbits->getPeriod( pIter->second ) );
+
+	return true;
+}
+
+// Looks up a Topology by the name used in Scene Files.
+bool SceneLoader::parseTopology( const char* cName, eSphereTopology* pTopology )
+{
+	for ( unsigned int i = 0; i < MAX_TOPOLOGIES; ++i )
+	{
+		if ( 0 == strcmp( cName, c_pSceneTopologies[i] ) )
+		{
+			*pTopology = (eSphereTopology)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Transformation of a previously loaded, named body.  "-" is the World root.
+TransformHandle SceneLoader::findTransform( const char* cName )
+{
+	map< string, TransformHandle >::iterator pIter = m_pNamedTransforms.find( cName );
+
+	return m_pNamedTransforms.end() == pIter ? INVALID_TRANSFORM : pIter->second;
+}
+
+// Stops streaming, bodies already loaded are kept.
+void SceneLoader::close()
+{
+	if ( m_pFile.is_open() )
+		m_pFile.close();
+
+	m_pFile.clear();
+	m_sPendingLine.clear();
+}
+
+/************************************************************************\
+ * Texture Cache                                                        *
+\************************************************************************/
+
+// Returns the Texture for sFileName, decoding and uploading it on first use.
+const MyTexture* SceneLoader::getTexture( const string& sFileName )
+{
+	map< string, MyTexture* >::iterator pIter = m_pTextures.find( sFileName );
+	MyTexture* pTexture;
+
+	if ( m_pTextures.end() != pIter )
+		return pIter->second;
+
+	pTexture = new MyTexture();
+	if ( !InitializeTexture( pTexture, sFileName ) )
+		cout << "Error: Unable to load Texture " << sFileName << "." << endl;
+
+	m_pTextures[sFileName] = pTexture;
+	return pTexture;
+}
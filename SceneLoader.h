@@ -0,0 +1,77 @@
+#pragma once
+
+/* INCLUDES */
+#include "stdafx.h"
+#include "SceneGraph.h"
+#include "ImageReader.h"
+#include "MeshGenerator.h"
+#include "OrbitSystem.h"
+
+/* DEFINES */
+#define SCENE_NAME_LENGTH	64		// Longest Body, Parent or Topology name
+#define SCENE_PATH_LENGTH	256		// Longest Texture file name
+#define SCENE_BUDGET_CHECK	256		// Bodies created between checks of the time budget
+
+// Forward Declarations
+class Planet;
+
+// Class: SceneLoader
+// Purpose: Builds Planets and their Transformations from a scene description file.  The file
+//			is streamed: open() reads the header, reserves space for every body it declares and
+//			decodes the listed Textures on the pool, then each loadChunk() creates bodies until
+//			its time budget runs out so large catalogs load across many frames.
+//
+// Scene File Format: one entry per line, '#' starts a comment.
+//	bodies <count>							Header, must come first.  Used to reserve memory.
+//	texture <file>							Optional, decoded in parallel by open().
+//	body <name> <parent> <texture> <radius> <axial tilt> <secs/rotation> <secs/orbit> <x> <y> <z> <lit> <topology>
+//											A Body with its own Transformation, translated by x y z
+//											from its parent ("-" for the World root).  With a
+//											non-zero secs/orbit it circles its parent through x y z.
+//	orbit <name> <semi-major axis> <eccentricity> <inclination> <ascending node> <arg periapsis> <mean anomaly>
+//											Optional, replaces the circular orbit of a named body
+//											loaded earlier with these elements (angles in degrees).
+//	attach <name> <host> <texture> <radius> <axial tilt> <secs/rotation> <lit> <topology>
+//											A Body sharing host's Transformation (e.g. a sky sphere).
+//	Names of "-" are not recorded and can't be used as a parent, which keeps catalogs cheap.
+//	Topologies are uv, ico or cube.  Textures not listed up front are decoded when first used.
+class SceneLoader
+{
+public:
+	SceneLoader( SceneGraph* pSceneGraph, OrbitSystem* pOrbits );
+	~SceneLoader();
+
+	// Streaming
+	bool open( const string& sFileName, vector<Planet*>* pPlanets );
+	bool loadChunk( double dBudgetSecs );
+	bool isLoading() const { return m_pFile.is_open(); }
+	unsigned int getNumDeclared() const { return m_iNumDeclared; }
+	unsigned int getNumLoaded() const { return m_iNumLoaded; }
+
+private:
+	SceneLoader( const SceneLoader* pCopy );	// Don't allow use of Copy Constructor
+
+	// Parsing
+	bool readLine( string& sLine );
+	bool parseEntry( const string& sLine );
+	bool parseOrbit( const string& sLine );
+	bool parseTopology( const char* cName, eSphereTopology* pTopology );
+	TransformHandle findTransform( const char* cName );
+	void close();
+
+	// Texture Cache, one Texture per file no matter how many Planets use it.
+	const MyTexture* getTexture( const string& sFileName );
+
+	SceneGraph* m_pSceneGraph;
+	OrbitSystem* m_pOrbits;
+	vector<Planet*>* m_pPlanets;
+	map< string, TransformHandle > m_pNamedTransforms;
+	map< string, unsigned int > m_pNamedOrbits;
+	map< string, MyTexture* > m_pTextures;
+
+	ifstream m_pFile;
+	string m_sFileName;
+	string m_sPendingLine;		// Read by open() past the header, not yet parsed
+	unsigned int m_iLineNumber;
+	unsigned int m_iNumDeclared, m_iNumLoaded;
+};
@@ -4,14 +4,10 @@
 // Defines //
 /////////////
 
-#define TO_WORLD_LOCATION			m_sA2ShaderVarLocations[TO_WORLD_MAT]
-#define TO_CAMERA_LOCATION			m_sA2ShaderVarLocations[TO_CAM_MAT]
-#define PERSPECTIVE_M_LOCATION		m_sA2ShaderVarLocations[PERSPECTIVE_MAT]
-#define LOCAL_TRANSFORM_LOCATION	m_sA2ShaderVarLocations[LOCAL_TRANSFORM]
-#define SPEC_COLOR_LOCATION			m_sA2ShaderVarLocations[SPEC_COLOR]
-#define SPEC_EXP_LOCATION			m_sA2ShaderVarLocations[SPEC_EXP]
-#define LIGHT_PIXEL_LOCATION		m_sA2ShaderVarLocations[B_LIGHT_PIXEL]
-#define CAMERA_LOC_LOCATION			m_sA2ShaderVarLocations[CAM_LOCATION]
+#define TO_WORLD_LOCATION			m_sA2ShaderVarLocations[s][TO_WORLD_MAT]
+#define LOCAL_TRANSFORM_LOCATION	m_sA2ShaderVarLocations[s][LOCAL_TRANSFORM]
+#define LIGHT_PIXEL_LOCATION		m_sA2ShaderVarLocations[s][B_LIGHT_PIXEL]
+#define FENCE_TIMEOUT				1000000000	// Nanoseconds to wait on a Frame slot before retrying
 
 // Singleton Variable initialization
 ShaderManager* ShaderManager::m_pInstance = NULL;
@@ -19,13 +15,15 @@ ShaderManager* ShaderManager::m_pInstance = NULL;
 // Different Vertex Shaders required for each assignment
 const string m_sVShaderNames[MAX_SHDRS] = {
 	"vertex_A1.glsl",
-	"vertex_A2.glsl"
+	"vertex_A2.glsl",
+	"vertex_Instanced.glsl"
 };
 
 // Different Fragment Shaders required for each assignment
 const string m_sFShaderNames[MAX_SHDRS] = {
 	"fragment_A1.glsl",
-	"fragment_A2.glsl"
+	"fragment_A2.glsl",
+	"fragment_Instanced.glsl"
 };
 
 // Different Tessellation Control Shaders required for each assignment.
@@ -42,13 +40,8 @@ const string m_sTEShaderNames[MAX_SHDRS] = {
 
 // Assignment 2 Shader Variable Names.
 const GLchar* ShaderManager::c_sA2ShaderVarNames[MAX_A2_VARS] = { "mToWorld",
-																  "mToCamera",
-																  "mPerspective",
 																  "mLocalTransform",
-																  "pSpecColor",
-																  "fSpecExp",
-																  "bLightPixel",
-																  "mCameraLocation" };
+																  "bLightPixel" };
 
 // Public - Not a singleton
 // Designed mainly to manage different shaders between assignments.  
@@ -56,6 +49,13 @@ const GLchar* ShaderManager::c_sA2ShaderVarNames[MAX_A2_VARS] = { "mToWorld",
 ShaderManager::ShaderManager()
 {
 	m_bInitialized = false;
+	memset( m_bShadowValid, 0, sizeof( m_bShadowValid ) );
+	m_iNumUploads = m_iNumSkipped = 0;
+	m_iFrameUploads = m_iFrameSkipped = 0;
+	m_iFrameBuffer = 0;
+	m_iFrameStride = 0;
+	m_iFrameSlot = 0;
+	memset( m_pFrameFences, 0, sizeof( m_pFrameFences ) );
 }
 
 // Get the Singleton ShaderManager Object.  Initialize it if NULL.
@@ -72,6 +72,13 @@ ShaderManager::~ShaderManager()
 {
 	// unbind any shader programs
 	glUseProgram(0);
+
+	for ( unsigned int i = 0; i < FRAME_RING_SIZE; ++i )
+		if ( NULL != m_pFrameFences[i] )
+			glDeleteSync( m_pFrameFences[i] );
+
+	if ( 0 != m_iFrameBuffer )
+		glDeleteBuffers( 1, &m_iFrameBuffer );
 }
 
 /*******************************************************************\
@@ -83,19 +90,60 @@ bool ShaderManager::initializeShaders()
 {
 	m_bInitialized = m_pShader[REGULAR].initializeShader(m_sVShaderNames[REGULAR], m_sFShaderNames[REGULAR]);
 	m_bInitialized &= m_pShader[TEXTURE].initializeShader(m_sVShaderNames[TEXTURE], m_sFShaderNames[TEXTURE]);
+	m_bInitialized &= m_pShader[INSTANCED].initializeShader(m_sVShaderNames[INSTANCED], m_sFShaderNames[INSTANCED]);
+
+	// Freshly linked Programs hold none of the shadowed values.
+	memset( m_bShadowValid, 0, sizeof( m_bShadowValid ) );
 
+	// The Instanced Shader reads per-Body values from its Instances, so it's missing those Uniforms.
 	if ( m_bInitialized )
-		for ( unsigned int i = 0; i < MAX_A2_VARS; i++ )
-		{
-			m_sA2ShaderVarLocations[i] = m_pShader[TEXTURE].fetchVarLocation( c_sA2ShaderVarNames[i] );
-			if ( ERR_CODE == m_sA2ShaderVarLocations[i] )
-				cout << "Error: Couldn't get location for \"" << c_sA2ShaderVarNames[i] << "\"." << endl;
-		}
+		for ( unsigned int s = TEXTURE; s < MAX_SHDRS; ++s )
+			for ( unsigned int i = 0; i < MAX_A2_VARS; i++ )
+			{
+				m_sA2ShaderVarLocations[s][i] = m_pShader[s].fetchVarLocation( c_sA2ShaderVarNames[i] );
+				if ( TEXTURE == s && ERR_CODE == m_sA2ShaderVarLocations[s][i] )
+					cout << "Error: Couldn't get location for \"" << c_sA2ShaderVarNames[i] << "\"." << endl;
+			}
+
+	if ( m_bInitialized )
+		m_bInitialized = initializeFrameBuffer();
 
 	// return False if not all Shaders Initialized Properly
 	return m_bInitialized;
 }
 
+// Creates the Per-Frame Uniform ring and points every Program's FrameData block at its binding.
+//	Each slot starts on an offset the Buffer can be bound at.
+bool ShaderManager::initializeFrameBuffer()
+{
+	GLint iAlignment = 1;
+
+	glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &iAlignment );
+	m_iFrameStride = ((sizeof( FrameUniforms ) + iAlignment - 1) / iAlignment) * iAlignment;
+
+	if ( 0 == m_iFrameBuffer )
+		glGenBuffers( 1, &m_iFrameBuffer );
+	glBindBuffer( GL_UNIFORM_BUFFER, m_iFrameBuffer );
+	glBufferData( GL_UNIFORM_BUFFER, m_iFrameStride * FRAME_RING_SIZE, NULL, GL_DYNAMIC_DRAW );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+
+	// Programs without the block (REGULAR) are skipped.
+	for ( unsigned int s = 0; s < MAX_SHDRS; ++s )
+	{
+		GLuint iBlockIndex = glGetUniformBlockIndex( m_pShader[s].getProgram(), FRAME_BLOCK_NAME );
+
+		if ( GL_INVALID_INDEX != iBlockIndex )
+			glUniformBlockBinding( m_pShader[s].getProgram(), iBlockIndex, FRAME_BLOCK_BINDING );
+		else if ( TEXTURE <= s )
+		{
+			cout << "Error: Couldn't find the \"" << FRAME_BLOCK_NAME << "\" block." << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /*********************************************************************************************************************************\
  * Uniform Manipulation                                                                                                          *
 \*********************************************************************************************************************************/
@@ -103,87 +151,95 @@ bool ShaderManager::initializeShaders()
 // Sets the To World Matrix, dependent on the Scene that is going to World.
 void ShaderManager::setWorldMatrix( const mat4 &mToWorld )
 {
-	if ( ERR_CODE != TO_WORLD_LOCATION )
-	{
-		glUseProgram( m_pShader[TEXTURE].getProgram() );
-		glUniformMatrix4fv( TO_WORLD_LOCATION, 1, GL_FALSE, value_ptr( mToWorld ) );
-		glUseProgram(0);
-	}
+	for ( unsigned int s = TEXTURE; s < MAX_SHDRS; ++s )
+		if ( ERR_CODE != TO_WORLD_LOCATION && updateShadow( s, TO_WORLD_MAT, value_ptr( mToWorld ), 16 ) )
+			glProgramUniformMatrix4fv( m_pShader[s].getProgram(), TO_WORLD_LOCATION, 1, GL_FALSE, value_ptr( mToWorld ) );
 }
 
-// Sets the To Camera Matrix, dependent on the Camera Position.
-void ShaderManager::setCameraMatrix( const mat4 &mToCamera )
+// Sets the local transformation Matrix for Rotation and own Axis
+void ShaderManager::setLocalTransform( const mat4 &mTransform )
 {
-	if ( ERR_CODE != TO_CAMERA_LOCATION )
-	{
-		glUseProgram( m_pShader[TEXTURE].getProgram() );
-		glUniformMatrix4fv( TO_CAMERA_LOCATION, 1, GL_FALSE, value_ptr( mToCamera ) );
-		glUseProgram( 0 );
-	}
+	for ( unsigned int s = TEXTURE; s < MAX_SHDRS; ++s )
+		if ( ERR_CODE != LOCAL_TRANSFORM_LOCATION && updateShadow( s, LOCAL_TRANSFORM, value_ptr( mTransform ), 16 ) )
+			glProgramUniformMatrix4fv( m_pShader[s].getProgram(), LOCAL_TRANSFORM_LOCATION, 1, GL_FALSE, value_ptr( mTransform ) );
 }
 
-// Sets the Perspective Matrix to convert from Camera Space to View Space.
-void ShaderManager::setPerspective( const mat4 &mPerspective )
+// Set the Lighting Boolean to Light the Object
+void ShaderManager::setLightBool( bool bLight )
 {
-	if ( ERR_CODE != PERSPECTIVE_M_LOCATION )
-	{
-		glUseProgram( m_pShader[TEXTURE].getProgram() );
-		glUniformMatrix4fv( PERSPECTIVE_M_LOCATION, 1, GL_FALSE, value_ptr( mPerspective ) );
-		glUseProgram( 0 );
-	}
-}
+	GLfloat fLight = bLight ? 1.f : 0.f;	// Shadowed as a float like every other value
 
-// Sets the local transformation Matrix for Rotation and own Axis
-void ShaderManager::setLocalTransform( const mat4 &mTransform )
-{
-	if ( ERR_CODE != LOCAL_TRANSFORM_LOCATION )
-	{
-		glUseProgram( m_pShader[TEXTURE].getProgram() );
-		glUniformMatrix4fv( LOCAL_TRANSFORM_LOCATION, 1, GL_FALSE, value_ptr( mTransform ) );
-		glUseProgram( 0 );
-	}
+	for ( unsigned int s = TEXTURE; s < MAX_SHDRS; ++s )
+		if ( ERR_CODE != LIGHT_PIXEL_LOCATION && updateShadow( s, B_LIGHT_PIXEL, &fLight, 1 ) )
+			glProgramUniform1i( m_pShader[s].getProgram(), LIGHT_PIXEL_LOCATION, bLight );
 }
 
-// Set the Specular Color for an object
-void ShaderManager::setSpecularColor( const vec3 &mSpecColor )
+// Writes this frame's Camera and Lighting values to the next slot in the ring and binds it.  The
+//	slot was last used FRAME_RING_SIZE frames ago, so waiting on its fence rarely stalls.
+void ShaderManager::setFrameUniforms( const mat4 &mToCamera, const mat4 &mPerspective, const vec3 &vCamPos,
+									  const vec3 &vSpecColor, float fSpecExp )
 {
-	if ( ERR_CODE != SPEC_COLOR_LOCATION )
+	FrameUniforms pFrame;
+	GLintptr iOffset = m_iFrameSlot * m_iFrameStride;
+	void* pMapped;
+
+	memcpy( pFrame.fToCamera, value_ptr( mToCamera ), sizeof( pFrame.fToCamera ) );
+	memcpy( pFrame.fPerspective, value_ptr( mPerspective ), sizeof( pFrame.fPerspective ) );
+	memcpy( pFrame.fCameraLocation, value_ptr( vCamPos ), sizeof( pFrame.fCameraLocation ) );
+	pFrame.fSpecExp = fSpecExp;
+	memcpy( pFrame.fSpecColor, value_ptr( vSpecColor ), sizeof( pFrame.fSpecColor ) );
+	pFrame.fPadding = 0.f;
+
+	if ( NULL != m_pFrameFences[m_iFrameSlot] )
 	{
-		glUseProgram( m_pShader[TEXTURE].getProgram() );
-		glUniform3f( SPEC_COLOR_LOCATION, mSpecColor.r, mSpecColor.g, mSpecColor.b );
-		glUseProgram( 0 );
+		while ( GL_TIMEOUT_EXPIRED == glClientWaitSync( m_pFrameFences[m_iFrameSlot], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT ) );
+		glDeleteSync( m_pFrameFences[m_iFrameSlot] );
+		m_pFrameFences[m_iFrameSlot] = NULL;
 	}
-}
 
-// Set the Specular Exponent for the Object
-void ShaderManager::setSpecularExp( float fSpecExp )
-{
-	if ( ERR_CODE != SPEC_EXP_LOCATION )
+	// The fence guarantees the GPU is done with the slot, so the write needn't synchronize.
+	glBindBuffer( GL_UNIFORM_BUFFER, m_iFrameBuffer );
+	pMapped = glMapBufferRange( GL_UNIFORM_BUFFER, iOffset, sizeof( FrameUniforms ),
+								GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+	if ( NULL != pMapped )
 	{
-		glUseProgram( m_pShader[TEXTURE].getProgram() );
-		glUniform1f( SPEC_EXP_LOCATION, fSpecExp );
-		glUseProgram( 0 );
+		memcpy( pMapped, &pFrame, sizeof( FrameUniforms ) );
+		glUnmapBuffer( GL_UNIFORM_BUFFER );
 	}
+	else
+		glBufferSubData( GL_UNIFORM_BUFFER, iOffset, sizeof( FrameUniforms ), &pFrame );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+
+	glBindBufferRange( GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, m_iFrameBuffer, iOffset, sizeof( FrameUniforms ) );
 }
 
-// Set the Lighting Boolean to Light the Object
-void ShaderManager::setLightBool( bool bLight )
+// Fences the current slot behind the frame's draws and moves on to the next one.  The frame's
+//	Uniform Cache counts are kept for the getters and restarted for the next frame.
+void ShaderManager::endFrame()
 {
-	if ( ERR_CODE != LIGHT_PIXEL_LOCATION )
-	{
-		glUseProgram( m_pShader[TEXTURE].getProgram() );
-		glUniform1i( LIGHT_PIXEL_LOCATION, bLight );
-		glUseProgram( 0 );
-	}
+	m_pFrameFences[m_iFrameSlot] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	m_iFrameSlot = (m_iFrameSlot + 1) % FRAME_RING_SIZE;
+
+	m_iFrameUploads = m_iNumUploads;
+	m_iFrameSkipped = m_iNumSkipped;
+	m_iNumUploads = m_iNumSkipped = 0;
 }
 
-// Set the Location of the Camera in World Coordinates.
-void ShaderManager::setCameraLocation( const vec3 &mCamPos )
+// Compares a Uniform's new value against the last one uploaded and stores it if it differs.
+//	Returns true if the value has to be uploaded.
+bool ShaderManager::updateShadow( unsigned int iShader, eShaderVars eVar, const GLfloat* pValues, unsigned int iCount )
 {
-	if ( ERR_CODE != CAMERA_LOC_LOCATION )
+	GLfloat* pShadow = m_fShadowValues[iShader][eVar];
+	size_t iSize = iCount * sizeof( GLfloat );
+
+	if ( m_bShadowValid[iShader][eVar] && 0 == memcmp( pShadow, pValues, iSize ) )
 	{
-		glUseProgram( m_pShader[TEXTURE].getProgram() );
-		glUniform3f( CAMERA_LOC_LOCATION, mCamPos.x, mCamPos.y, mCamPos.z );
-		glUseProgram( 0 );
+		++m_iNumSkipped;
+		return false;
 	}
+
+	memcpy( pShadow, pValues, iSize );
+	m_bShadowValid[iShader][eVar] = true;
+	++m_iNumUploads;
+	return true;
 }
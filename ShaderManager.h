@@ -4,11 +4,28 @@
 #include "stdafx.h"
 #include "Shader.h"
 
+// Defines
+#define FRAME_BLOCK_NAME		"FrameData"
+#define FRAME_BLOCK_BINDING		0	// Uniform Buffer binding point of the Per-Frame block
+#define FRAME_RING_SIZE			3	// Frames that can be in flight before writing a slot waits on the GPU
+
+// Per-Frame Camera and Lighting Uniforms, laid out as the std140 FrameData block in the shaders.
+struct FrameUniforms
+{
+	GLfloat fToCamera[16];
+	GLfloat fPerspective[16];
+	GLfloat fCameraLocation[3];
+	GLfloat fSpecExp;
+	GLfloat fSpecColor[3];
+	GLfloat fPadding;
+};
+
 // Enum for Shaders
 enum eShaderType
 {
 	REGULAR = 0,
 	TEXTURE,
+	INSTANCED,		// TEXTURE with per-Body Uniforms read from Instance attributes
 	MAX_SHDRS
 };
 
@@ -36,13 +53,19 @@ public:
 
 	// Setting Uniforms
 	void setWorldMatrix(  const mat4 &mToWorld );
-	void setCameraMatrix( const mat4 &mToCamera );
-	void setPerspective( const mat4 &mPerspective );
 	void setLocalTransform( const mat4 &mTransform );
-	void setSpecularColor( const vec3 &mSpecColor );
-	void setSpecularExp( float fSpecExp );
 	void setLightBool( bool bLight );
-	void setCameraLocation( const vec3 &mCamPos );
+
+	// Per-Frame Uniforms: written to the next slot of the ring and bound for every Program.
+	//	endFrame() must follow the frame's last draw so the slot isn't overwritten while in use.
+	void setFrameUniforms( const mat4 &mToCamera, const mat4 &mPerspective, const vec3 &vCamPos,
+						   const vec3 &vSpecColor, float fSpecExp );
+	void endFrame();
+
+	// Uniform Cache Statistics for the last ended frame: uploads sent to GL versus skipped for
+	//	repeating the last value.
+	unsigned int getNumUniformUploads() const { return m_iFrameUploads; }
+	unsigned int getNumUniformsSkipped() const { return m_iFrameSkipped; }
 
 private:
 	// Singleton Implementation
@@ -60,19 +83,29 @@ private:
 	enum eShaderVars
 	{
 		TO_WORLD_MAT = 0,
-		TO_CAM_MAT,
-		PERSPECTIVE_MAT,
 		LOCAL_TRANSFORM,
 		// Lighting Variables
-		SPEC_COLOR,
-		SPEC_EXP,
 		B_LIGHT_PIXEL,
-		CAM_LOCATION,
 		MAX_A2_VARS 
 	};
 
-	// Store Uniform Shader Variable Locations for ASSG_2
-	GLint m_sA2ShaderVarLocations[MAX_A2_VARS];
+	// Store Uniform Shader Variable Locations for ASSG_2, per Shader that uses them (TEXTURE onwards).
+	GLint m_sA2ShaderVarLocations[MAX_SHDRS][MAX_A2_VARS];
 	static const GLchar* c_sA2ShaderVarNames[MAX_A2_VARS];
+
+	// Shadow of the last value uploaded to each Uniform, so repeated values never reach GL.
+	//	Uploads go straight to the Program (glProgramUniform*), nothing is bound to set them.
+	GLfloat m_fShadowValues[MAX_SHDRS][MAX_A2_VARS][16];
+	bool m_bShadowValid[MAX_SHDRS][MAX_A2_VARS];
+	unsigned int m_iNumUploads, m_iNumSkipped;		// Current frame, restarted by endFrame()
+	unsigned int m_iFrameUploads, m_iFrameSkipped;	// Last ended frame
+	bool updateShadow( unsigned int iShader, eShaderVars eVar, const GLfloat* pValues, unsigned int iCount );
+
+	// Ring of Per-Frame Uniform slots in one Uniform Buffer, each fenced until the GPU is done with it.
+	GLuint m_iFrameBuffer;
+	GLsizeiptr m_iFrameStride;		// sizeof( FrameUniforms ) rounded up to the offset alignment
+	unsigned int m_iFrameSlot;
+	GLsync m_pFrameFences[FRAME_RING_SIZE];
+	bool initializeFrameBuffer();
 };
 
@@ -0,0 +1,44 @@
+#include "SimulationClock.h"
+
+// Constructor, starts unpaused at time 0 with a Time Scale of 1.
+SimulationClock::SimulationClock( double dTimeStep )
+{
+	m_dTimeStep = dTimeStep;
+	m_dTimeScale = 1.0;
+	m_dAccumulator = 0.0;
+	m_iStep = 0;
+	m_bPaused = false;
+	m_pLastAdvance = chrono::steady_clock::now();
+}
+
+// Destructor
+SimulationClock::~SimulationClock()
+{
+}
+
+// Adds the wall time since the last call to the accumulator and consumes it in whole steps.
+//	Wall time passing while paused is dropped, so resuming continues where it left off.
+unsigned int SimulationClock::advance()
+{
+	chrono::steady_clock::time_point mNow = chrono::steady_clock::now();
+	double dElapsedSecs = chrono::duration<double>( mNow - m_pLastAdvance ).count();
+	unsigned int iSteps;
+
+	m_pLastAdvance = mNow;
+	if ( m_bPaused )
+		return 0;
+
+	m_dAccumulator += (dElapsedSecs > MAX_FRAME_SECS ? MAX_FRAME_SECS : dElapsedSecs) * m_dTimeScale;
+	iSteps = (unsigned int)floor( m_dAccumulator / m_dTimeStep );
+	m_dAccumulator -= iSteps * m_dTimeStep;
+	m_dAccumulator = m_dAccumulator < 0.0 ? 0.0 : m_dAccumulator;
+	m_iStep += iSteps;
+
+	return iSteps;
+}
+
+// Sets how many simulated seconds pass per wall second.
+void SimulationClock::setTimeScale( double dTimeScale )
+{
+	m_dTimeScale = dTimeScale < MIN_TIME_SCALE ? MIN_TIME_SCALE : (dTimeScale > MAX_TIME_SCALE ? MAX_TIME_SCALE : dTimeScale);
+}
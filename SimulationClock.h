@@ -0,0 +1,48 @@
+#pragma once
+
+/* INCLUDES */
+#include "stdafx.h"
+
+/* DEFINES */
+#define MAX_FRAME_SECS		0.25	// Longer frames (stalls, window drags) are clamped to this
+#define MIN_TIME_SCALE		(1.0 / 64.0)
+#define MAX_TIME_SCALE		4096.0
+
+// Class: SimulationClock
+// Purpose: Central clock for the simulation.  Wall time is read from a monotonic clock once per
+//			frame, scaled, and consumed in fixed steps so the simulation doesn't depend on the
+//			frame rate or CPU load.  The time left over is exposed as an interpolation factor
+//			for rendering between the last two steps.
+class SimulationClock
+{
+public:
+	SimulationClock( double dTimeStep );
+	~SimulationClock();
+
+	// Reads the wall clock and returns how many fixed steps were completed since the last call.
+	unsigned int advance();
+
+	// Simulation Time of the latest step, and of iStepsBack steps before it.
+	double getTime() const { return (double)m_iStep * m_dTimeStep; }
+	double getTime( unsigned int iStepsBack ) const { return (double)(m_iStep - iStepsBack) * m_dTimeStep; }
+	double getTimeStep() const { return m_dTimeStep; }
+
+	// Fraction of a step between the previous step and the latest, to render at.
+	float getAlpha() const { return (float)(m_dAccumulator / m_dTimeStep); }
+
+	// Controls
+	void setPaused( bool bPaused ) { m_bPaused = bPaused; }
+	void togglePause() { m_bPaused = !m_bPaused; }
+	bool isPaused() const { return m_bPaused; }
+	void setTimeScale( double dTimeScale );
+	double getTimeScale() const { return m_dTimeScale; }
+
+private:
+	SimulationClock( const SimulationClock& pCopy );	// Don't allow use of Copy Constructor
+
+	chrono::steady_clock::time_point m_pLastAdvance;
+	double m_dTimeStep, m_dTimeScale;
+	double m_dAccumulator;			// Scaled time not yet consumed by a step, always < m_dTimeStep
+	unsigned long long m_iStep;		// Steps taken, Time is derived from it so it never drifts
+	bool m_bPaused;
+};
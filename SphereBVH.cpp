@@ -0,0 +1,376 @@
+#include "SphereBVH.h"
+
+// Whether vSphere is at least partly inside all six planes.
+static bool SphereInFrustum( const vec4& vSphere, const vec4* vPlanes )
+{
+	bool bReturn = true;
+
+	for ( int p = 0; p < 6 && bReturn; ++p )
+		bReturn = dot( vec3( vPlanes[p] ), vec3( vSphere ) ) + vPlanes[p].w >= -vSphere.w;
+
+	return bReturn;
+}
+
+// Distance along the normalized vDir to vSphere, negative if the ray misses.  A ray starting
+//	inside the Sphere hits it at distance 0.
+static float IntersectRay( const vec4& vSphere, const vec3& vOrigin, const vec3& vDir )
+{
+	vec3 vToCenter = vec3( vSphere ) - vOrigin;
+	float fAlong = dot( vToCenter, vDir );
+	float fDistSq = dot( vToCenter, vToCenter );
+	vec3 vPerpendicular = vToCenter - vDir * fAlong;	// Stays precise far from the origin
+	float fDiscriminant = vSphere.w * vSphere.w - dot( vPerpendicular, vPerpendicular );
+
+	if ( fDistSq <= vSphere.w * vSphere.w )
+		return 0.f;
+	else if ( fDiscriminant < 0.f )
+		return -1.f;
+
+	return fAlong - sqrt( fDiscriminant );
+}
+
+// Constructor
+SphereBVH::SphereBVH()
+{
+	m_fBuiltArea = 0.f;
+}
+
+// Destructor
+SphereBVH::~SphereBVH()
+{
+}
+
+/************************************************************************\
+ * Spheres                                                              *
+\************************************************************************/
+
+// Adds a Sphere returning its Proxy, it's found by queries straight away.
+unsigned int SphereBVH::addSphere( const vec3& vCenter, float fRadius, unsigned int iUserData )
+{
+	m_vSpheres.push_back( vec4( vCenter, fRadius ) );
+	m_vUserData.push_back( iUserData );
+
+	return m_vSpheres.size() - 1;
+}
+
+// Makes sure iNumSpheres can be held without allocating, apart from the tree itself.
+void SphereBVH::reserve( unsigned int iNumSpheres )
+{
+	m_vSpheres.reserve( iNumSpheres );
+	m_vUserData.reserve( iNumSpheres );
+	m_vLeafProxies.reserve( iNumSpheres );
+}
+
+// Removes every Sphere.
+void SphereBVH::clear()
+{
+	m_vSpheres.clear();
+	m_vUserData.clear();
+	m_vNodes.clear();
+	m_vLeafProxies.clear();
+	m_fBuiltArea = 0.f;
+}
+
+/************************************************************************\
+ * Maintenance                                                          *
+\************************************************************************/
+
+// Refits every node bottom-up.  Spheres stay in the leaves they were built into, so as they
+//	move the nodes grow and overlap; once the total surface area (a proxy for query cost) has
+//	grown by BVH_REBUILD_RATIO the tree is rebuilt instead.  Rebuilding when the unbuilt Spheres
+//	pass a fraction of the tree keeps the cost of streaming bodies in linear overall.
+void SphereBVH::refit()
+{
+	float fArea = 0.f;
+
+	if ( getNumUnbuilt() > BVH_UNBUILT_RATIO * m_vLeafProxies.size() )
+	{
+		build();
+		return;
+	}
+
+	for ( unsigned int i = m_vNodes.size(); i-- > 0; )
+	{
+		BVHNode& pNode = m_vNodes[i];
+
+		if ( 0 == pNode.iLeft )
+			fitNode( pNode );
+		else
+		{
+			pNode.vMin = min( m_vNodes[pNode.iLeft].vMin, m_vNodes[pNode.iLeft + 1].vMin );
+			pNode.vMax = max( m_vNodes[pNode.iLeft].vMax, m_vNodes[pNode.iLeft + 1].vMax );
+		}
+
+		fArea += getArea( pNode );
+	}
+
+	if ( fArea > m_fBuiltArea * BVH_REBUILD_RATIO )
+		build();
+}
+
+// Builds the tree from scratch over the current Spheres.
+void SphereBVH::build()
+{
+	m_vNodes.clear();
+	m_vLeafProxies.resize( m_vSpheres.size() );
+	m_fBuiltArea = 0.f;
+
+	if ( m_vSpheres.empty() )
+		return;
+
+	for ( unsigned int i = 0; i < m_vLeafProxies.size(); ++i )
+		m_vLeafProxies[i] = i;
+
+	// Median splits give at most 2 * Spheres / (BVH_LEAF_SIZE / 2) nodes
+	m_vNodes.reserve( 4 * m_vSpheres.size() / BVH_LEAF_SIZE + 1 );
+	m_vNodes.push_back( BVHNode() );
+	m_vNodes[0].iFirstProxy = 0;
+	m_vNodes[0].iNumProxies = m_vLeafProxies.size();
+	buildNode( 0 );
+
+	for ( unsigned int i = 0; i < m_vNodes.size(); ++i )
+		m_fBuiltArea += getArea( m_vNodes[i] );
+}
+
+// Fits iNode to its range of Proxies and, if there are too many for a leaf, splits the range at
+//	the median along the longest axis of the Sphere centers.
+void SphereBVH::buildNode( unsigned int iNode )
+{
+	unsigned int iFirst = m_vNodes[iNode].iFirstProxy;
+	unsigned int iCount = m_vNodes[iNode].iNumProxies;
+	unsigned int iLeft, iHalf = iCount / 2;
+	vec3 vMin( FLT_MAX ), vMax( -FLT_MAX ), vExtent;
+	int iAxis = 0;
+
+	m_vNodes[iNode].iLeft = 0;
+	fitNode( m_vNodes[iNode] );
+	if ( iCount <= BVH_LEAF_SIZE )
+		return;
+
+	for ( unsigned int i = iFirst; i < iFirst + iCount; ++i )
+	{
+		vec3 vCenter = vec3( m_vSpheres[m_vLeafProxies[i]] );
+		vMin = min( vMin, vCenter );
+		vMax = max( vMax, vCenter );
+	}
+	vExtent = vMax - vMin;
+	iAxis = vExtent.y > vExtent.x ? 1 : 0;
+	iAxis = vExtent.z > vExtent[iAxis] ? 2 : iAxis;
+
+	nth_element( m_vLeafProxies.begin() + iFirst, m_vLeafProxies.begin() + iFirst + iHalf, m_vLeafProxies.begin() + iFirst + iCount,
+				 [this, iAxis]( unsigned int iLHS, unsigned int iRHS ) { return m_vSpheres[iLHS][iAxis] < m_vSpheres[iRHS][iAxis]; } );
+
+	// Children are added as a pair, m_vNodes may reallocate so nodes are referred to by index.
+	iLeft = m_vNodes.size();
+	m_vNodes.push_back( BVHNode() );
+	m_vNodes.push_back( BVHNode() );
+	m_vNodes[iNode].iLeft = iLeft;
+	m_vNodes[iLeft].iFirstProxy = iFirst;
+	m_vNodes[iLeft].iNumProxies = iHalf;
+	m_vNodes[iLeft + 1].iFirstProxy = iFirst + iHalf;
+	m_vNodes[iLeft + 1].iNumProxies = iCount - iHalf;
+
+	buildNode( iLeft );
+	buildNode( iLeft + 1 );
+}
+
+// Sets the node's bounds to the Spheres in its range.
+void SphereBVH::fitNode( BVHNode& pNode )
+{
+	pNode.vMin = vec3( FLT_MAX );
+	pNode.vMax = vec3( -FLT_MAX );
+
+	for ( unsigned int i = pNode.iFirstProxy; i < pNode.iFirstProxy + pNode.iNumProxies; ++i )
+	{
+		const vec4& vSphere = m_vSpheres[m_vLeafProxies[i]];
+		pNode.vMin = min( pNode.vMin, vec3( vSphere ) - vSphere.w );
+		pNode.vMax = max( pNode.vMax, vec3( vSphere ) + vSphere.w );
+	}
+}
+
+// Surface Area of the node's bounds.
+float SphereBVH::getArea( const BVHNode& pNode ) const
+{
+	vec3 vExtent = pNode.vMax - pNode.vMin;
+	return 2.f * (vExtent.x * vExtent.y + vExtent.y * vExtent.z + vExtent.z * vExtent.x);
+}
+
+/************************************************************************\
+ * Queries                                                              *
+\************************************************************************/
+
+// Appends every Sphere below pNode.
+void SphereBVH::appendSubtree( const BVHNode& pNode, vector<unsigned int>& vResults ) const
+{
+	for ( unsigned int i = pNode.iFirstProxy; i < pNode.iFirstProxy + pNode.iNumProxies; ++i )
+		vResults.push_back( m_vUserData[m_vLeafProxies[i]] );
+}
+
+// Spheres at least partly inside the frustum of mViewProjection.  Nodes entirely inside every
+//	plane are appended whole without testing anything below them.
+void SphereBVH::queryFrustum( const mat4& mViewProjection, vector<unsigned int>& vResults ) const
+{
+	const mat4& m = mViewProjection;
+	vec4 vRow[4], vPlanes[6];
+	unsigned int iStack[BVH_STACK_SIZE], iStackSize = 0;
+
+	// Clip Space planes (Gribb/Hartmann), normalized so distances are in World units.
+	for ( int r = 0; r < 4; ++r )
+		vRow[r] = vec4( m[0][r], m[1][r], m[2][r], m[3][r] );
+	for ( int p = 0; p < 3; ++p )
+	{
+		vPlanes[2 * p] = vRow[3] + vRow[p];
+		vPlanes[2 * p + 1] = vRow[3] - vRow[p];
+	}
+	for ( int p = 0; p < 6; ++p )
+		vPlanes[p] /= length( vec3( vPlanes[p] ) );
+
+	for ( unsigned int i = m_vLeafProxies.size(); i < m_vSpheres.size(); ++i )
+	{
+		if ( SphereInFrustum( m_vSpheres[i], vPlanes ) )
+			vResults.push_back( m_vUserData[i] );
+	}
+
+	if ( !m_vNodes.empty() )
+		iStack[iStackSize++] = 0;
+	while ( iStackSize > 0 )
+	{
+		const BVHNode& pNode = m_vNodes[iStack[--iStackSize]];
+		bool bOutside = false, bInside = true;
+
+		// Test the box corner furthest along each plane's normal, then the nearest.
+		for ( int p = 0; p < 6 && !bOutside; ++p )
+		{
+			vec3 vNormal = vec3( vPlanes[p] );
+			vec3 vFar = vec3( vNormal.x >= 0.f ? pNode.vMax.x : pNode.vMin.x, vNormal.y >= 0.f ? pNode.vMax.y : pNode.vMin.y, vNormal.z >= 0.f ? pNode.vMax.z : pNode.vMin.z );
+			vec3 vNear = pNode.vMin + pNode.vMax - vFar;
+
+			bOutside = dot( vNormal, vFar ) + vPlanes[p].w < 0.f;
+			bInside &= dot( vNormal, vNear ) + vPlanes[p].w >= 0.f;
+		}
+
+		if ( bOutside )
+			continue;
+		else if ( bInside )
+			appendSubtree( pNode, vResults );
+		else if ( 0 != pNode.iLeft )
+		{
+			iStack[iStackSize++] = pNode.iLeft + 1;
+			iStack[iStackSize++] = pNode.iLeft;
+		}
+		else
+		{
+			for ( unsigned int i = pNode.iFirstProxy; i < pNode.iFirstProxy + pNode.iNumProxies; ++i )
+			{
+				if ( SphereInFrustum( m_vSpheres[m_vLeafProxies[i]], vPlanes ) )
+					vResults.push_back( m_vUserData[m_vLeafProxies[i]] );
+			}
+		}
+	}
+}
+
+// Spheres intersecting the sphere at vCenter of fRadius.
+void SphereBVH::queryRadius( const vec3& vCenter, float fRadius, vector<unsigned int>& vResults ) const
+{
+	unsigned int iStack[BVH_STACK_SIZE], iStackSize = 0;
+
+	for ( unsigned int i = m_vLeafProxies.size(); i < m_vSpheres.size(); ++i )
+	{
+		vec3 vDelta = vec3( m_vSpheres[i] ) - vCenter;
+
+		if ( dot( vDelta, vDelta ) <= (fRadius + m_vSpheres[i].w) * (fRadius + m_vSpheres[i].w) )
+			vResults.push_back( m_vUserData[i] );
+	}
+
+	if ( !m_vNodes.empty() )
+		iStack[iStackSize++] = 0;
+	while ( iStackSize > 0 )
+	{
+		const BVHNode& pNode = m_vNodes[iStack[--iStackSize]];
+		vec3 vClosest = clamp( vCenter, pNode.vMin, pNode.vMax );
+
+		if ( dot( vClosest - vCenter, vClosest - vCenter ) > fRadius * fRadius )
+			continue;
+		else if ( 0 != pNode.iLeft )
+		{
+			iStack[iStackSize++] = pNode.iLeft + 1;
+			iStack[iStackSize++] = pNode.iLeft;
+		}
+		else
+		{
+			for ( unsigned int i = pNode.iFirstProxy; i < pNode.iFirstProxy + pNode.iNumProxies; ++i )
+			{
+				const vec4& vSphere = m_vSpheres[m_vLeafProxies[i]];
+				vec3 vDelta = vec3( vSphere ) - vCenter;
+
+				if ( dot( vDelta, vDelta ) <= (fRadius + vSphere.w) * (fRadius + vSphere.w) )
+					vResults.push_back( m_vUserData[m_vLeafProxies[i]] );
+			}
+		}
+	}
+}
+
+// Walks the nearer Child first and skips nodes further than the closest hit so far.
+unsigned int SphereBVH::queryRay( const vec3& vOrigin, const vec3& vDirection, float* pDistance ) const
+{
+	vec3 vDir = normalize( vDirection );
+	vec3 vInvDir = vec3( 1.f ) / vDir;
+	unsigned int iStack[BVH_STACK_SIZE], iStackSize = 0;
+	unsigned int iReturn = INVALID_PROXY;
+	float fBest = FLT_MAX, fHit;
+
+	for ( unsigned int i = m_vLeafProxies.size(); i < m_vSpheres.size(); ++i )
+	{
+		fHit = IntersectRay( m_vSpheres[i], vOrigin, vDir );
+		if ( fHit >= 0.f && fHit < fBest )
+		{
+			fBest = fHit;
+			iReturn = m_vUserData[i];
+		}
+	}
+
+	if ( !m_vNodes.empty() )
+		iStack[iStackSize++] = 0;
+	while ( iStackSize > 0 )
+	{
+		const BVHNode& pNode = m_vNodes[iStack[--iStackSize]];
+
+		// Slab test, Infinities from axis-aligned rays compare correctly
+		vec3 vT0 = (pNode.vMin - vOrigin) * vInvDir;
+		vec3 vT1 = (pNode.vMax - vOrigin) * vInvDir;
+		vec3 vNear = min( vT0, vT1 ), vFar = max( vT0, vT1 );
+		float fEnter = std::max( std::max( vNear.x, vNear.y ), std::max( vNear.z, 0.f ) );
+		float fExit = std::min( std::min( vFar.x, vFar.y ), vFar.z );
+
+		if ( fEnter > fExit || fEnter > fBest )
+			continue;
+		else if ( 0 != pNode.iLeft )
+		{
+			// Push the further Child first so the nearer is walked first.
+			const BVHNode& pLeft = m_vNodes[pNode.iLeft];
+			const BVHNode& pRight = m_vNodes[pNode.iLeft + 1];
+			bool bLeftNearer = dot( (pLeft.vMin + pLeft.vMax) - (pRight.vMin + pRight.vMax), vDir ) <= 0.f;
+
+			iStack[iStackSize++] = bLeftNearer ? pNode.iLeft + 1 : pNode.iLeft;
+			iStack[iStackSize++] = bLeftNearer ? pNode.iLeft : pNode.iLeft + 1;
+		}
+		else
+		{
+			for ( unsigned int i = pNode.iFirstProxy; i < pNode.iFirstProxy + pNode.iNumProxies; ++i )
+			{
+				fHit = IntersectRay( m_vSpheres[m_vLeafProxies[i]], vOrigin, vDir );
+
+				if ( fHit >= 0.f && fHit < fBest )
+				{
+					fBest = fHit;
+					iReturn = m_vUserData[m_vLeafProxies[i]];
+				}
+			}
+		}
+	}
+
+	if ( NULL != pDistance )
+		*pDistance = fBest;
+
+	return iReturn;
+}
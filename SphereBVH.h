@@ -0,0 +1,73 @@
+#pragma once
+#include "stdafx.h"
+
+// Forward Declarations
+class ThreadPool;
+
+// Definitions
+#define INVALID_PROXY		0xFFFFFFFF
+#define BVH_LEAF_SIZE		4		// Most Spheres a leaf holds
+#define BVH_STACK_SIZE		64		// Traversal stack, enough for a median split tree of 2^64 leaves
+#define BVH_REBUILD_RATIO	2.f		// Rebuild once refits have grown the tree's surface area this much
+#define BVH_UNBUILT_RATIO	0.25f	// Rebuild once Spheres added since the last build exceed this fraction
+
+// A node of the tree: an AABB over every Sphere below it.  Children are always stored as a pair
+//	after their parent, so a reverse walk over the nodes visits children before parents.
+struct BVHNode
+{
+	vec3 vMin;
+	unsigned int iLeft;			// First of the two Children, 0 for a leaf (the root is never a child)
+	vec3 vMax;
+	unsigned int iFirstProxy;	// Range of m_vLeafProxies covered by this subtree
+	unsigned int iNumProxies;
+};
+
+// Class: SphereBVH
+// Purpose: Bounding Volume Hierarchy over bounding spheres.  The tree is built top-down with a
+//			median split and then refit in place as the spheres move; it is only rebuilt when
+//			the refits have degraded it or enough spheres were added.  Spheres added since the
+//			last build are tested one by one.  Queries walk the tree and only touch the spheres
+//			in the leaves they reach, returning each sphere's User Data.
+class SphereBVH
+{
+public:
+	SphereBVH();
+	~SphereBVH();
+
+	// Spheres
+	unsigned int addSphere( const vec3& vCenter, float fRadius, unsigned int iUserData );
+	void setSphere( unsigned int iProxy, const vec3& vCenter, float fRadius ) { m_vSpheres[iProxy] = vec4( vCenter, fRadius ); }
+	void reserve( unsigned int iNumSpheres );
+	void clear();
+	unsigned int getNumSpheres() const { return m_vSpheres.size(); }
+	unsigned int getNumNodes() const { return m_vNodes.size(); }
+
+	// Maintenance
+	// Brings the bounds up to date with setSphere(), rebuilding if needed.  build() always does.
+	void refit();
+	void build();
+
+	// Queries, the User Data of every Sphere found is appended to vResults.
+	void queryFrustum( const mat4& mViewProjection, vector<unsigned int>& vResults ) const;
+	void queryRadius( const vec3& vCenter, float fRadius, vector<unsigned int>& vResults ) const;
+	// Nearest Sphere hit by the ray, INVALID_PROXY if none.  pDistance is along vDirection.
+	unsigned int queryRay( const vec3& vOrigin, const vec3& vDirection, float* pDistance ) const;
+
+private:
+	SphereBVH( const SphereBVH& pCopy );	// Don't allow use of Copy Constructor
+
+	// Per Sphere, indexed by Proxy
+	vector<vec4> m_vSpheres;				// Center, Radius
+	vector<unsigned int> m_vUserData;
+
+	// Tree
+	vector<BVHNode> m_vNodes;
+	vector<unsigned int> m_vLeafProxies;	// Proxies ordered so every node covers a contiguous range
+	float m_fBuiltArea;						// Surface area of the tree when last built
+
+	void buildNode( unsigned int iNode );
+	void fitNode( BVHNode& pNode );
+	float getArea( const BVHNode& pNode ) const;
+	void appendSubtree( const BVHNode& pNode, vector<unsigned int>& vResults ) const;
+	unsigned int getNumUnbuilt() const { return m_vSpheres.size() - m_vLeafProxies.size(); }
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include "stdafx.h"
+
+// Local Transform stored as Translation, Rotation and Scale.
+// Rotation is applied after Translation, so a rotation orbits the node about its parent, and
+//	Scale is applied first: R * T * S.
+struct TRS
+{
+	vec3 vTranslation;
+	quat qRotation;
+	vec3 vScale;
+
+	// initialize to the identity transform
+	TRS() : vTranslation( 0.f ), qRotation( 1.f, 0.f, 0.f, 0.f ), vScale( 1.f )
+	{
+	}
+
+	explicit TRS( const vec3& vT ) : vTranslation( vT ), qRotation( 1.f, 0.f, 0.f, 0.f ), vScale( 1.f )
+	{
+	}
+
+	// Builds R * T * S directly: the rotation's columns scaled by vScale, and vTranslation rotated.
+	mat4 toMatrix() const
+	{
+		const quat& q = qRotation;
+		float fXX = q.x * q.x, fYY = q.y * q.y, fZZ = q.z * q.z;
+		float fXY = q.x * q.y, fXZ = q.x * q.z, fYZ = q.y * q.z;
+		float fWX = q.w * q.x, fWY = q.w * q.y, fWZ = q.w * q.z;
+		mat4 mReturn;
+
+		mReturn[0] = vec4( 1.f - 2.f * (fYY + fZZ), 2.f * (fXY + fWZ), 2.f * (fXZ - fWY), 0.f );
+		mReturn[1] = vec4( 2.f * (fXY - fWZ), 1.f - 2.f * (fXX + fZZ), 2.f * (fYZ + fWX), 0.f );
+		mReturn[2] = vec4( 2.f * (fXZ + fWY), 2.f * (fYZ - fWX), 1.f - 2.f * (fXX + fYY), 0.f );
+		mReturn[3] = mReturn[0] * vTranslation.x + mReturn[1] * vTranslation.y + mReturn[2] * vTranslation.z;
+		mReturn[3].w = 1.f;
+		mReturn[0] *= vScale.x;
+		mReturn[1] *= vScale.y;
+		mReturn[2] *= vScale.z;
+		return mReturn;
+	}
+};
@@ -0,0 +1,185 @@
+#include "ThreadPool.h"
+
+// Singleton static setup
+ThreadPool* ThreadPool::m_pInstance = NULL;
+
+// Queue owned by the calling thread, workers set this on startup.
+static thread_local unsigned int s_iWorkerIndex = UINT_MAX;
+
+// Constructor, spins up the workers.
+ThreadPool::ThreadPool( unsigned int iNumThreads )
+{
+	m_iQueuedJobs = 0;
+	m_iPendingJobs = 0;
+	m_bShutdown = false;
+
+	for ( unsigned int i = 0; i <= iNumThreads; ++i )
+		m_pQueues.push_back( new JobQueue() );
+
+	for ( unsigned int i = 0; i < iNumThreads; ++i )
+		m_pWorkers.push_back( thread( &ThreadPool::workerLoop, this, i ) );
+}
+
+// Singleton getter, one worker per hardware thread.
+ThreadPool* ThreadPool::getInstance()
+{
+	if ( NULL == m_pInstance )
+	{
+		unsigned int iNumThreads = thread::hardware_concurrency();
+		m_pInstance = new ThreadPool( 0 == iNumThreads ? 1 : iNumThreads );
+	}
+
+	return m_pInstance;
+}
+
+// Destructor, lets queued jobs finish then joins the workers.
+ThreadPool::~ThreadPool()
+{
+	{
+		unique_lock<mutex> pLock( m_pSleepMutex );
+		m_bShutdown = true;
+	}
+	m_pJobAvailable.notify_all();
+
+	for ( unsigned int i = 0; i < m_pWorkers.size(); ++i )
+		m_pWorkers[i].join();
+
+	for ( unsigned int i = 0; i < m_pQueues.size(); ++i )
+		delete m_pQueues[i];
+
+	m_pWorkers.clear();
+	m_pQueues.clear();
+	m_pInstance = NULL;
+}
+
+/************************************************************************\
+ * Job Management                                                       *
+\************************************************************************/
+
+// Queues a job.  Jobs added by a worker go on its own queue so related work stays on
+//	one thread unless another runs dry and steals it.
+void ThreadPool::addJob( const function<void()>& pJob )
+{
+	JobQueue* pQueue = m_pQueues[ currentQueue() ];
+
+	// Counted before the job can be seen, so a thief's decrement can never come first.
+	++m_iPendingJobs;
+	{
+		unique_lock<mutex> pLock( pQueue->pMutex );
+		++m_iQueuedJobs;
+		pQueue->pJobs.push_back( pJob );
+	}
+
+	// Take the Sleep Lock so a worker can't miss the wake up between its check and its wait.
+	{
+		unique_lock<mutex> pLock( m_pSleepMutex );
+	}
+	m_pJobAvailable.notify_one();
+}
+
+// Blocks until every queued job, including jobs added by other jobs, has run.
+// The waiting thread runs jobs itself rather than sitting idle.
+void ThreadPool::waitForAll()
+{
+	function<void()> pJob;
+	unsigned int iQueue = currentQueue();
+
+	while ( 0 != m_iPendingJobs )
+	{
+		if ( findJob( iQueue, pJob ) )
+			runJob( pJob );
+		else
+		{
+			unique_lock<mutex> pLock( m_pSleepMutex );
+			m_pJobsFinished.wait( pLock, [this]() { return 0 == m_iPendingJobs || 0 != m_iQueuedJobs; } );
+		}
+	}
+}
+
+// Splits [0, iCount) into ranges of at most iGrainSize and runs pBody( iBegin, iEnd ) on each,
+//	returning once all ranges are done.  Must be called from outside the pool.
+void ThreadPool::parallelFor( unsigned int iCount, unsigned int iGrainSize, const function<void( unsigned int, unsigned int )>& pBody )
+{
+	iGrainSize = 0 == iGrainSize ? 1 : iGrainSize;
+
+	for ( unsigned int iBegin = 0; iBegin < iCount; iBegin += iGrainSize )
+	{
+		unsigned int iEnd = iCount - iBegin > iGrainSize ? iBegin + iGrainSize : iCount;
+		addJob( [&pBody, iBegin, iEnd]() { pBody( iBegin, iEnd ); } );
+	}
+
+	waitForAll();
+}
+
+// Index of the queue belonging to the calling thread, threads outside the pool share the last one.
+unsigned int ThreadPool::currentQueue() const
+{
+	return UINT_MAX == s_iWorkerIndex ? m_pWorkers.size() : s_iWorkerIndex;
+}
+
+// Pops the newest job from iQueue, otherwise steals the oldest job from another queue.
+bool ThreadPool::findJob( unsigned int iQueue, function<void()>& pJob )
+{
+	unsigned int iNumQueues = m_pQueues.size();
+
+	for ( unsigned int i = 0; i < iNumQueues; ++i )
+	{
+		JobQueue* pQueue = m_pQueues[ (iQueue + i) % iNumQueues ];
+		unique_lock<mutex> pLock( pQueue->pMutex );
+
+		if ( !pQueue->pJobs.empty() )
+		{
+			if ( 0 == i )
+			{
+				pJob = pQueue->pJobs.back();
+				pQueue->pJobs.pop_back();
+			}
+			else
+			{
+				pJob = pQueue->pJobs.front();
+				pQueue->pJobs.pop_front();
+			}
+
+			--m_iQueuedJobs;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Runs a job taken from a queue and wakes any waiters once the last pending job is done.
+void ThreadPool::runJob( function<void()>& pJob )
+{
+	pJob();
+	pJob = nullptr;
+
+	if ( 0 == --m_iPendingJobs )
+	{
+		{
+			unique_lock<mutex> pLock( m_pSleepMutex );
+		}
+		m_pJobsFinished.notify_all();
+	}
+}
+
+// Runs jobs until the pool is shut down and every queue is empty.
+void ThreadPool::workerLoop( unsigned int iIndex )
+{
+	function<void()> pJob;
+	s_iWorkerIndex = iIndex;
+
+	while ( true )
+	{
+		if ( findJob( iIndex, pJob ) )
+			runJob( pJob );
+		else
+		{
+			unique_lock<mutex> pLock( m_pSleepMutex );
+			m_pJobAvailable.wait( pLock, [this]() { return m_bShutdown || 0 != m_iQueuedJobs; } );
+
+			if ( m_bShutdown && 0 == m_iQueuedJobs )
+				return;
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+/* INCLUDES */
+#include "stdafx.h"
+
+// Class: ThreadPool
+// Purpose: A fixed set of worker threads for CPU-side work (image decoding, mesh generation,
+//			scene updates) that doesn't touch OpenGL; anything requiring the context must stay
+//			on the main thread.
+//			Each worker owns a job deque: it pops its own newest job and, when empty, steals
+//			the oldest job from another worker.  Jobs added from outside the pool go to a
+//			shared deque that every worker steals from.
+class ThreadPool
+{
+public:
+	static ThreadPool* getInstance();
+	~ThreadPool();
+
+	// Job Management
+	void addJob( const function<void()>& pJob );
+	void waitForAll();
+	void parallelFor( unsigned int iCount, unsigned int iGrainSize, const function<void( unsigned int, unsigned int )>& pBody );
+	unsigned int getNumThreads() const { return m_pWorkers.size(); }
+
+private:
+	// Singleton Implementation
+	ThreadPool( unsigned int iNumThreads );
+	static ThreadPool* m_pInstance;
+
+	// A single Worker's Jobs, the owner works from the back, thieves from the front.
+	struct JobQueue
+	{
+		mutex pMutex;
+		deque< function<void()> > pJobs;
+	};
+
+	void workerLoop( unsigned int iIndex );
+	unsigned int currentQueue() const;
+	bool findJob( unsigned int iQueue, function<void()>& pJob );
+	void runJob( function<void()>& pJob );
+
+	vector<thread> m_pWorkers;
+	vector<JobQueue*> m_pQueues;		// One per Worker followed by the shared queue.
+	atomic<unsigned int> m_iQueuedJobs;		// Waiting in a queue
+	atomic<unsigned int> m_iPendingJobs;	// Queued + Running
+	bool m_bShutdown;
+
+	mutex m_pSleepMutex;
+	condition_variable m_pJobAvailable;
+	condition_variable m_pJobsFinished;
+};
@@ -1,13 +1,15 @@
 #include "Transformation.h"
 
 
-// Takes translation Matrix, and 3 angles in degrees for X, Y and Z
+// Starts at the given Translation with no Rotation
 Transformation::Transformation( vec3 vTranslation )
+	: m_pLocal( vTranslation )
 {
-	m_TranslationMatrix = translate( mat4( 1.f ), vTranslation );
-	m_RotationMatrix = mat4( 1.f );
-
-	m_pParent = NULL;
+	m_bWorldDirty = true;
+	m_iSubtreeSize = 1;
+	m_iPoolIndex = UINT_MAX;
+	m_pParent = m_pFirstChild = m_pLastChild = NULL;
+	m_pPrevSibling = m_pNextSibling = NULL;
 }
 
 // Destructor
@@ -20,42 +22,85 @@ Transformation::~Transformation()
 bool Transformation::operator== (Transformation &pRHS)
 {
 	bool bReturn = this->m_pParent == pRHS.m_pParent;							// Same Parent
-	bReturn &= this->m_TranslationMatrix == pRHS.m_TranslationMatrix;			// Same Translation
-	bReturn &= this->m_pChildren.size() == pRHS.m_pChildren.size();				// Same Number of Children
+	bReturn &= this->m_pLocal.vTranslation == pRHS.m_pLocal.vTranslation;		// Same Translation
+	bReturn &= this->m_pLocal.vScale == pRHS.m_pLocal.vScale;					// Same Scale
+	bReturn &= this->m_iSubtreeSize == pRHS.m_iSubtreeSize;						// Same Number of Descendants
+
+	bReturn &= this->m_pLocal.qRotation == pRHS.m_pLocal.qRotation;				// Same Rotations
 
-	bReturn &= this->m_RotationMatrix == pRHS.m_RotationMatrix;					// Same Rotation Matrices
-		
-	if ( bReturn )	// If  Same Number of Children
-		for ( unsigned int i = 0; i < this->m_pChildren.size(); ++i )
-			bReturn &= this->m_pChildren[i] == pRHS.m_pChildren[i];				// Same Children
+	// Same Children
+	Transformation* pLHSChild = this->m_pFirstChild;
+	Transformation* pRHSChild = pRHS.m_pFirstChild;
+	for ( ; bReturn && NULL != pLHSChild && NULL != pRHSChild; pLHSChild = pLHSChild->m_pNextSibling, pRHSChild = pRHSChild->m_pNextSibling )
+		bReturn &= pLHSChild == pRHSChild;
+	bReturn &= pLHSChild == pRHSChild;
 
 	return bReturn;
 }
 
 // Get the Transformation
+// The World Matrix is only rebuilt if it's been invalidated since the last call, composing the
+//	Local Transform straight into it.  The Parent-space Matrix is built on request.
 mat4 Transformation::getTransformationMatrix( bool bToWorld )
 {
-	// Apply This Transformation
-	mat4 mReturnMatrix = m_RotationMatrix * m_TranslationMatrix;
+	if ( !bToWorld )
+		return m_pLocal.toMatrix();
 
-	// Apply Parent Transformations if desired.
-	if ( bToWorld && NULL != m_pParent )
-		mReturnMatrix = m_pParent->getTransformationMatrix( bToWorld ) * mReturnMatrix;
+	// Apply Parent Transformations.
+	if ( m_bWorldDirty )
+	{
+		m_WorldMatrix = m_pLocal.toMatrix();
+		if ( NULL != m_pParent )
+			m_WorldMatrix = m_pParent->getTransformationMatrix( true ) * m_WorldMatrix;
+		m_bWorldDirty = false;
+	}
 
 	// Return resulting Transform
-	return mReturnMatrix;
+	return m_WorldMatrix;
 }
 
 // Update Functions
-// Further Rotate the current Rotation Transform.
-void Transformation::updateRotation( const mat4 &mFurtherRotation )
+// Further Rotate the current Rotation.  The product is renormalized so repeated small rotations
+//	can't drift away from a unit quaternion.
+void Transformation::updateRotation( const quat &qFurtherRotation )
 {
-	m_RotationMatrix = mFurtherRotation * m_RotationMatrix;
+	quat qRotation = qFurtherRotation * m_pLocal.qRotation;
+
+	// One Newton step towards unit length, cancels the rounding a single product introduces.
+	m_pLocal.qRotation = qRotation * ((3.f - dot( qRotation, qRotation )) * 0.5f);
+	invalidateWorld();
 }
 
-// given delta vector, modify the translation matrix for new translation
+// given delta vector, modify the translation for new translation
 void Transformation::translateByDelta( vec3 vTranslation )
 {
-	mat4 pNewTranslate = translate( mat4( 1.f ), vTranslation );
-	m_TranslationMatrix = pNewTranslate * m_TranslationMatrix;
+	m_pLocal.vTranslation += vTranslation;
+	invalidateWorld();
+}
+
+// Replaces the Translation, leaving Rotation and Scale as they are.
+void Transformation::setTranslation( const vec3& vTranslation )
+{
+	m_pLocal.vTranslation = vTranslation;
+	invalidateWorld();
+}
+
+// Replaces the whole Local Transform.
+void Transformation::setLocal( const TRS& pLocal )
+{
+	m_pLocal = pLocal;
+	m_pLocal.qRotation = normalize( m_pLocal.qRotation );
+	invalidateWorld();
+}
+
+// Marks the World Matrix of this node and its subtree as stale.  A clean node always has clean
+//	ancestors, so a node that's already dirty has a dirty subtree and the walk can stop there.
+void Transformation::invalidateWorld()
+{
+	if ( !m_bWorldDirty )
+	{
+		m_bWorldDirty = true;
+		for ( Transformation* pChild = m_pFirstChild; NULL != pChild; pChild = pChild->m_pNextSibling )
+			pChild->invalidateWorld();
+	}
 }
@@ -1,7 +1,9 @@
 #pragma once
 #include "stdafx.h"
+#include "TRS.h"
 
-// Contains a Transformation and Translation Matrix to Transform to World or Parent Space.
+// Contains a Rotation and Translation (as a TRS) to Transform to World or Parent Space.
+// The World Matrix is cached and only rebuilt after a change to this node or an ancestor.
 class Transformation
 {
 public:
@@ -18,17 +20,38 @@ public:
 	mat4 getTransformationMatrix( bool bToWorld );
 
 	// Update Functions
-	void updateRotation( const mat4 &mFurtherRotation );
+	void updateRotation( const quat &qFurtherRotation );
 	void translateByDelta( vec3 vTranslation );
+	void setTranslation( const vec3& vTranslation );
+	void setLocal( const TRS& pLocal );
+	const TRS& getLocal() const { return m_pLocal; }
+
+	// Hierarchy Traversal
+	Transformation* getParent() const		{ return m_pParent; }
+	Transformation* getFirstChild() const	{ return m_pFirstChild; }
+	Transformation* getNextSibling() const	{ return m_pNextSibling; }
+	unsigned int getSubtreeSize() const		{ return m_iSubtreeSize; }
 
 private:	
 	Transformation( Transformation* pCopy ); // Don't allow use of Copy Constructor
 
-	mat4 m_TranslationMatrix;
-	mat4 m_RotationMatrix;
+	TRS m_pLocal;
+
+	// Cached World Matrix, Parent's World * Local
+	mat4 m_WorldMatrix;
+	bool m_bWorldDirty;
+	void invalidateWorld();
+
+	// Number of nodes in this subtree, including this one.
+	unsigned int m_iSubtreeSize;
 
+	// Intrusive Hierarchy Links, children are kept in the order they were added.
 	Transformation* m_pParent;
-	vector<Transformation*> m_pChildren;
+	Transformation* m_pFirstChild;
+	Transformation* m_pLastChild;
+	Transformation* m_pPrevSibling;
+	Transformation* m_pNextSibling;
+	unsigned int m_iPoolIndex;		// Slot in the owning SceneGraph's pool
 
 	friend class SceneGraph;
 };
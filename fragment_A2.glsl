@@ -9,9 +9,17 @@
 // uniform = constant variable over everytime shader runs.
 uniform sampler2D image;		
 
+// Per-Frame Camera and Lighting Uniforms, written once a frame by the ShaderManager (FrameUniforms)
+layout(std140) uniform FrameData
+{
+	mat4 mToCamera;
+	mat4 mPerspective;
+	vec3 mCameraLocation;
+	float fSpecExp;
+	vec3 vSpecColor;
+};
+
 // Lighting Uniforms
-uniform vec3 vSpecColor;
-uniform float fSpecExp;
 uniform bool bLightPixel;
 
 // Color of Light
@@ -59,16 +67,16 @@ vec3 calculateSpecular( )
 void main(void)
 {
 	vec3 vDiffuseColor;
-	vec3 vSpecColor;
+	vec3 vSpecularColor;
 	vec4 texelColor = texture(image, fragTexture);
 	
 	if( bLightPixel )
 	{
 		vDiffuseColor = calculateDiffuse();
-		vSpecColor = calculateSpecular();
+		vSpecularColor = calculateSpecular();
 		
 		texelColor *= vDiffuseColor;
-		texelColor += vSpecColor;
+		texelColor += vSpecularColor;
 	}
 	
 	FragmentColour = texelColor;
@@ -0,0 +1,79 @@
+// ==========================================================================
+// Instanced fragment program, fragment_A2.glsl with the Lighting flag passed
+// per Instance from vertex_Instanced.glsl
+// ==========================================================================
+#version 410
+
+// uniform = constant variable over everytime shader runs.
+uniform sampler2D image;		
+
+// Per-Frame Camera and Lighting Uniforms, written once a frame by the ShaderManager (FrameUniforms)
+layout(std140) uniform FrameData
+{
+	mat4 mToCamera;
+	mat4 mPerspective;
+	vec3 mCameraLocation;
+	float fSpecExp;
+	vec3 vSpecColor;
+};
+
+// Color of Light
+const vec3 vLightColor = vec3( 1.0, 1.0, 1.0 );				  
+
+// interpolated colour received from vertex stage
+in vec2 fragTexture;
+
+// Input Variables for Lighting
+in vec4 vNormal;
+in vec3 vToLight;
+in vec3 vToEye;
+in vec3 vWorldPos;
+flat in int bLightPixel;
+
+// first output is mapped to the framebuffer's colour index by default
+out vec4 FragmentColour;
+
+vec3 calculateDiffuse( )
+{
+	vec3 vDiffuseReturn;
+	
+	float fLightIntensity = dot(vec3(vNormal),vToLight);		// Intensity of the Light
+	fLightIntensity = max( 0.0, fLightIntensity );	// Ignore negative Intensities
+	
+	vDiffuseReturn = vLightColor * fLightIntensity;
+	
+	return vDiffuseReturn;
+}
+
+vec3 calculateSpecular( )
+{
+	vec3 vSpecularReturn;
+	float fCosSigma;
+	vec3 vHVect = normalize( vToLight + vToEye );
+	
+	fCosSigma = dot( vHVect, vec3( vNormal ) );
+	fCosSigma = max( 0.0, fCosSigma );
+	fCosSigma = pow( fCosSigma, fSpecExp );
+	vSpecularReturn = vLightColor * fCosSigma;
+	vSpecularReturn *= vSpecColor;
+	
+	return vSpecularReturn;
+}
+
+void main(void)
+{
+	vec3 vDiffuseColor;
+	vec3 vSpecularColor;
+	vec4 texelColor = texture(image, fragTexture);
+	
+	if( 0 != bLightPixel )
+	{
+		vDiffuseColor = calculateDiffuse();
+		vSpecularColor = calculateSpecular();
+		
+		texelColor *= vDiffuseColor;
+		texelColor += vSpecularColor;
+	}
+	
+	FragmentColour = texelColor;
+}
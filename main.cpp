@@ -24,7 +24,8 @@ bool initializeWindow( GLFWwindow** rWindow, int iHeight, int iWidth, const char
 
 //
 // Entry for Program
-int main()
+// An optional Scene File to load can be given as the first argument (default DEFAULT_SCENE).
+int main( int argc, char** argv )
 {
 	int iRunning = glfwInit();
 	GLFWwindow*		m_Window = 0;
@@ -54,7 +55,7 @@ int main()
 
 		// Bind window to graphics Manager
 		if ( 1 == iRunning )
-			m_GpxMngr = GraphicsManager::getInstance( m_Window );
+			m_GpxMngr = GraphicsManager::getInstance( m_Window, argc > 1 ? argv[1] : DEFAULT_SCENE );
 
 		// Initialize the Mouse Handler.
 		m_MseHndlr = Mouse_Handler::getInstance( m_Window );
@@ -163,17 +164,26 @@ void KeyCallback( GLFWwindow* window, int key, int scancode, int action, int mod
 				glfwSetWindowShouldClose( window, GL_TRUE );
 				break;
 			case (GLFW_KEY_SPACE) :
-				pGrphxMngr->toggleAnimation();
+				pGrphxMngr->togglePause();
 				break;
 			case (GLFW_KEY_F) :
-				pGrphxMngr->toggleFastForward();
+				pGrphxMngr->setFastForward( true );
+				break;
+			case (GLFW_KEY_EQUAL) :											// Double Time Scale
+				pGrphxMngr->scaleTime( 2.0 );
+				break;
+			case (GLFW_KEY_MINUS) :											// Halve Time Scale
+				pGrphxMngr->scaleTime( 0.5 );
+				break;
+			case (GLFW_KEY_I) :												// Print Render Statistics
+				pGrphxMngr->printRenderStats();
 				break;
 		}
 	}
 	else if ( GLFW_RELEASE == action )
 	{
 		if ( GLFW_KEY_F == key )
-			pGrphxMngr->toggleFastForward();
+			pGrphxMngr->setFastForward( false );
 	}
 }
 
@@ -9,15 +9,25 @@
 #include <math.h>
 #include <iostream> 
 #include <fstream>
+#include <sstream>
 #include <algorithm>
 #include <iterator>
 #include <vector>
+#include <map>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
 #include <limits.h>
 #include <ctime>
 #include "EnvSpec.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
 
 #ifdef USING_LINUX
 #include <string.h>
@@ -9,7 +9,7 @@
 // location indices for these attributes correspond to those specified in the
 // InitializeGeometry() function of the main program
 layout(location = 0) in vec3 VertexPosition;
-layout(location = 1) in vec3 VertexColour;
+layout(location = 1) in vec2 VertexUV;
 layout(location = 2) in vec2 VertexTexture;
 
 // output to be interpolated between vertices and passed to the fragment stage
@@ -23,10 +23,17 @@ out vec3 vWorldPos;
 
 // Uniform Projection Matrices
 uniform mat4 mToWorld;
-uniform mat4 mToCamera;
-uniform mat4 mPerspective;
 uniform mat4 mLocalTransform;
-uniform vec3 mCameraLocation;
+
+// Per-Frame Camera and Lighting Uniforms, written once a frame by the ShaderManager (FrameUniforms)
+layout(std140) uniform FrameData
+{
+	mat4 mToCamera;
+	mat4 mPerspective;
+	vec3 mCameraLocation;
+	float fSpecExp;
+	vec3 vSpecColor;
+};
 
 // Constants
 const float fZeroBound = 1e-7;
@@ -40,9 +47,8 @@ void main()
     // assign vertex position without modification
     gl_Position = vec4(VertexPosition, 1.0);
 	
-	// truncate texture coords to values between [0,1]
-	fragTexture.x = VertexColour.y / 360.0;
-	fragTexture.y = VertexColour.x / -180.0;
+	// texture coords are precomputed between [0,1] on the CPU
+	fragTexture = VertexUV;
 	
 	// Apply Tranformations
 	gl_Position = mLocalTransform * gl_Position;		// Local Rotations	
@@ -0,0 +1,67 @@
+// ==========================================================================
+// Instanced vertex program for drawing every Body that shares a Mesh at once
+//
+// Based on vertex_A2.glsl, the Uniforms that changed per Body come from the
+// Instance attributes instead.
+// ==========================================================================
+#version 410
+
+// location indices for these attributes correspond to those specified in the
+// uploadMesh() function of the GeometryManager
+layout(location = 0) in vec3 VertexPosition;
+layout(location = 1) in vec2 VertexUV;
+
+// Per-Instance attributes, see BodyInstance
+layout(location = 3) in mat4 mToWorld;
+layout(location = 7) in vec4 vSpinRadiusLit;	// Spin (radians), Radius, Lit, unused
+
+// output to be interpolated between vertices and passed to the fragment stage
+out vec2 fragTexture;
+
+// Output Variables for Lighting
+out vec4 vNormal;
+out vec3 vToLight;
+out vec3 vToEye;
+out vec3 vWorldPos;
+flat out int bLightPixel;
+
+// Per-Frame Camera and Lighting Uniforms, written once a frame by the ShaderManager (FrameUniforms)
+layout(std140) uniform FrameData
+{
+	mat4 mToCamera;
+	mat4 mPerspective;
+	vec3 mCameraLocation;
+	float fSpecExp;
+	vec3 vSpecColor;
+};
+
+// Light Position (In World Coordinates)
+const vec3 vLightPos = vec3( 0.0, 0.0, 0.0 );
+
+void main()
+{
+	float fCos = cos( vSpinRadiusLit.x );
+	float fSin = sin( vSpinRadiusLit.x );
+
+	// texture coords are precomputed between [0,1] on the CPU
+	fragTexture = VertexUV;
+	bLightPixel = int( vSpinRadiusLit.z );
+
+	// Local Spin about +Y, the Unit Sphere's position is also its Normal
+	vec3 vLocal = vec3( fCos * VertexPosition.x + fSin * VertexPosition.z,
+						VertexPosition.y,
+						-fSin * VertexPosition.x + fCos * VertexPosition.z );
+
+	// Get Normal in World Space.
+	vNormal = mToWorld * vec4( normalize( vLocal ), 0.0 );
+
+	gl_Position = mToWorld * vec4( vLocal * vSpinRadiusLit.y, 1.0 );	// Scale, then to world position
+
+	// Calculate Lighting Vectors now that Vertex is in World Coords
+	vWorldPos 	= vec3( gl_Position );
+	vToEye 		= normalize( mCameraLocation - vWorldPos );
+	vToLight 	= normalize( vLightPos - vWorldPos );
+
+	// Translate Vertex to View Space, we have everything we need to shade it.
+	gl_Position = mPerspective * mToCamera * gl_Position;
+}